@@ -0,0 +1,24 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// One of the group of libraries that BM_dlclose_group loads and unloads. Each has its own TLS,
+// which has to be unregistered when the group is unloaded.
+
+__thread int dlclose_benchmark_tls_var;
+
+extern "C" int dlclose_benchmark_bump() {
+  return ++dlclose_benchmark_tls_var;
+}
@@ -14,9 +14,24 @@
  * limitations under the License.
  */
 
+#include <android-base/file.h>
 #include <android-base/strings.h>
 #include <benchmark/benchmark.h>
 #include <dlfcn.h>
+#include <link.h>
+#include <math.h>
+#include <unwind.h>
+
+#include <atomic>
+#include <iterator>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__BIONIC__)
+#include <android/dlext.h>
+#endif
 
 #include "util.h"
 
@@ -37,3 +52,263 @@ BIONIC_TRIVIAL_BENCHMARK(BM_dladdr_libc_printf, bm_dladdr(printf));
 BIONIC_TRIVIAL_BENCHMARK(BM_dladdr_libdl_dladdr, bm_dladdr(dladdr));
 BIONIC_TRIVIAL_BENCHMARK(BM_dladdr_local_function, bm_dladdr(local_function));
 BIONIC_TRIVIAL_BENCHMARK(BM_dladdr_libbase_split, bm_dladdr(android::base::Split));
+
+// Symbolizing a backtrace calls dladdr() once per frame, with frames spread across
+// the executable and several libraries. The last "frame" isn't in any library,
+// which is the worst case for the lookup.
+static void BM_dladdr_backtrace(benchmark::State& state) {
+  int stack_local;
+  const void* frames[] = {
+      reinterpret_cast<void*>(local_function),
+      reinterpret_cast<void*>(BM_dladdr_backtrace),
+      reinterpret_cast<void*>(printf),
+      reinterpret_cast<void*>(malloc),
+      reinterpret_cast<void*>(dladdr),
+      reinterpret_cast<void*>(android::base::Split),
+      reinterpret_cast<void*>(static_cast<double (*)(double)>(sin)),
+      &stack_local,
+  };
+
+  for (auto _ : state) {
+    for (const void* frame : frames) {
+      Dl_info info;
+      benchmark::DoNotOptimize(dladdr(frame, &info));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * std::size(frames));
+}
+BIONIC_BENCHMARK(BM_dladdr_backtrace);
+
+// Repeated lookups of the same (handle, name) pair, as done by plugin frameworks.
+static void BM_dlsym_handle_same_name(benchmark::State& state) {
+  void* handle = dlopen("libc.so", RTLD_NOW);
+  if (handle == nullptr) abort();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(dlsym(handle, "malloc"));
+  }
+  dlclose(handle);
+}
+BIONIC_BENCHMARK(BM_dlsym_handle_same_name);
+
+// Repeated dlopen()/dlclose() of a library that's already loaded, as done by plugin frameworks
+// that re-resolve their plugins on every use.
+static void BM_dlopen_loaded(benchmark::State& state) {
+  void* handle = dlopen("libc.so", RTLD_NOW);
+  if (handle == nullptr) abort();
+  for (auto _ : state) {
+    void* again = dlopen("libc.so", RTLD_NOW);
+    if (again == nullptr) abort();
+    dlclose(again);
+  }
+  dlclose(handle);
+}
+BIONIC_BENCHMARK(BM_dlopen_loaded);
+
+static void BM_dlopen_noload(benchmark::State& state) {
+  void* handle = dlopen("libc.so", RTLD_NOW);
+  if (handle == nullptr) abort();
+  for (auto _ : state) {
+    void* again = dlopen("libc.so", RTLD_NOW | RTLD_NOLOAD);
+    if (again == nullptr) abort();
+    dlclose(again);
+  }
+  dlclose(handle);
+}
+BIONIC_BENCHMARK(BM_dlopen_noload);
+
+// The linker only takes its fast path for already-loaded libraries without an extinfo (or with
+// just ANDROID_DLEXT_USE_NAMESPACE), so an empty extinfo always goes through the full dlopen().
+static void* bm_dlopen_libc_full(int flags) {
+#if defined(__BIONIC__)
+  android_dlextinfo extinfo = {};
+  return android_dlopen_ext("libc.so", flags, &extinfo);
+#else
+  return dlopen("libc.so.6", flags);
+#endif
+}
+
+static void BM_dlopen_loaded_full(benchmark::State& state) {
+  void* handle = dlopen("libc.so", RTLD_NOW);
+  if (handle == nullptr) abort();
+  for (auto _ : state) {
+    void* again = bm_dlopen_libc_full(RTLD_NOW);
+    if (again == nullptr) abort();
+    dlclose(again);
+  }
+  dlclose(handle);
+}
+BIONIC_BENCHMARK(BM_dlopen_loaded_full);
+
+// dlclose() of a library with seven dependencies, all with TLS, that nothing else loads, so that
+// every dlclose() tears down the whole group of eight. The dlopen() isn't timed.
+static void BM_dlclose_group(benchmark::State& state) {
+  // The libraries are in /data/nativetest[64]/bionic-benchmarks-dlclose, next to
+  // /data/benchmarktest[64]/bionic-benchmarks.
+  std::string exe_dir = android::base::GetExecutableDirectory();
+  std::string root = android::base::Dirname(android::base::Dirname(exe_dir));
+  std::string test_dir = android::base::Basename(android::base::Dirname(exe_dir));
+  std::string path = root + "/" +
+                     android::base::StringReplace(test_dir, "benchmarktest", "nativetest", false) +
+                     "/bionic-benchmarks-dlclose/libbionic_benchmarks_dlclose_root.so";
+
+  void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (handle == nullptr) {
+    state.SkipWithError(dlerror());
+    return;
+  }
+  dlclose(handle);
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (handle == nullptr) abort();
+    state.ResumeTiming();
+    dlclose(handle);
+  }
+}
+BIONIC_BENCHMARK(BM_dlclose_group);
+
+#if defined(__BIONIC__)
+// From libdl_android; the namespace API isn't in the NDK headers.
+extern "C" android_namespace_t* android_create_namespace(const char* name,
+                                                        const char* ld_library_path,
+                                                        const char* default_library_path,
+                                                        uint64_t type,
+                                                        const char* permitted_when_isolated_path,
+                                                        android_namespace_t* parent);
+extern "C" bool android_link_namespaces(android_namespace_t* from, android_namespace_t* to,
+                                        const char* shared_libs_sonames);
+
+// Returns an isolated namespace that shares the default namespace's libraries and is linked to
+// `num_links` other namespaces, the last of which provides libc.so. This is the shape of an app
+// classloader namespace with several vendor/APEX links. Namespaces can't be destroyed, so they're
+// kept for the life of the process.
+static android_namespace_t* bm_linked_namespace(int num_links) {
+  static std::map<int, android_namespace_t*> namespaces;
+  auto it = namespaces.find(num_links);
+  if (it != namespaces.end()) return it->second;
+
+  constexpr uint64_t kIsolatedShared = 1 /* ISOLATED */ | 2 /* SHARED */;
+  std::string name = "bm_linked_" + std::to_string(num_links);
+  android_namespace_t* ns =
+      android_create_namespace(name.c_str(), nullptr, "/data/empty", kIsolatedShared, nullptr,
+                               nullptr);
+  if (ns == nullptr) abort();
+  for (int i = 0; i < num_links; ++i) {
+    std::string link_name = name + "_" + std::to_string(i);
+    android_namespace_t* linked =
+        android_create_namespace(link_name.c_str(), nullptr, "/data/empty", kIsolatedShared,
+                                 nullptr, nullptr);
+    if (linked == nullptr) abort();
+    bool last = (i == num_links - 1);
+    if (!android_link_namespaces(ns, linked, last ? "libc.so" : "libbm_not_there.so")) abort();
+    if (last && !android_link_namespaces(linked, nullptr, "libc.so")) abort();
+  }
+  namespaces[num_links] = ns;
+  return ns;
+}
+
+// dlopen() of an already-loaded library from a namespace that has to consult its links.
+static void BM_dlopen_in_namespace(benchmark::State& state) {
+  android_dlextinfo extinfo = {};
+  extinfo.flags = ANDROID_DLEXT_USE_NAMESPACE;
+  extinfo.library_namespace = bm_linked_namespace(state.range(0));
+  void* handle = android_dlopen_ext("libc.so", RTLD_NOW, &extinfo);
+  if (handle == nullptr) abort();
+  for (auto _ : state) {
+    void* again = android_dlopen_ext("libc.so", RTLD_NOW, &extinfo);
+    if (again == nullptr) abort();
+    dlclose(again);
+  }
+  dlclose(handle);
+}
+BIONIC_BENCHMARK_WITH_ARG(BM_dlopen_in_namespace, "1 4 16");
+#endif
+
+// Runs `fun` on the benchmark thread while `num_threads` other threads call `background` in a
+// loop, to measure how much loader calls on other threads slow down lookups.
+template <typename F, typename B>
+static void RunWithBackgroundThreads(benchmark::State& state, size_t num_threads, F fun,
+                                     B background) {
+  std::atomic<bool> done = false;
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < num_threads; ++i) {
+    threads.emplace_back([&]() {
+      while (!done.load(std::memory_order_relaxed)) background();
+    });
+  }
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(fun());
+  }
+
+  done = true;
+  for (auto& thread : threads) thread.join();
+}
+
+static void* bm_dlsym_libc_malloc() {
+  void* sym = dlsym(RTLD_DEFAULT, "malloc");
+  if (sym == nullptr) abort();
+  return sym;
+}
+
+static void bm_dlopen_dlclose_libc() {
+  void* handle = bm_dlopen_libc_full(RTLD_NOW);
+  if (handle == nullptr) abort();
+  dlclose(handle);
+}
+
+#define BM_DLFCN_CONTENDED(NAME, FUN, BACKGROUND, NUM_THREADS)        \
+  static void BM_##NAME##_##NUM_THREADS(benchmark::State& state) {    \
+    RunWithBackgroundThreads(state, NUM_THREADS, FUN, BACKGROUND);    \
+  }                                                                   \
+  BIONIC_BENCHMARK(BM_##NAME##_##NUM_THREADS);
+
+// Concurrent lookups only.
+BM_DLFCN_CONTENDED(dlsym_with_dlsym, bm_dlsym_libc_malloc, bm_dlsym_libc_malloc, 1);
+BM_DLFCN_CONTENDED(dlsym_with_dlsym, bm_dlsym_libc_malloc, bm_dlsym_libc_malloc, 4);
+BM_DLFCN_CONTENDED(dladdr_with_dladdr, []() { return bm_dladdr(printf); },
+                   []() { bm_dladdr(printf); }, 1);
+BM_DLFCN_CONTENDED(dladdr_with_dladdr, []() { return bm_dladdr(printf); },
+                   []() { bm_dladdr(printf); }, 4);
+
+// Lookups while other threads keep taking the loader lock for writing.
+BM_DLFCN_CONTENDED(dlsym_with_dlopen, bm_dlsym_libc_malloc, bm_dlopen_dlclose_libc, 1);
+BM_DLFCN_CONTENDED(dladdr_with_dlopen, []() { return bm_dladdr(printf); },
+                   bm_dlopen_dlclose_libc, 1);
+
+static int bm_dl_iterate_phdr_count(dl_phdr_info*, size_t, void* data) {
+  ++*static_cast<size_t*>(data);
+  return 0;
+}
+
+static size_t bm_dl_iterate_phdr() {
+  size_t count = 0;
+  dl_iterate_phdr(bm_dl_iterate_phdr_count, &count);
+  return count;
+}
+
+static _Unwind_Reason_Code bm_unwind_count_frame(_Unwind_Context*, void* data) {
+  ++*static_cast<size_t*>(data);
+  return _URC_NO_REASON;
+}
+
+// Unwinding the stack, as done for every exception thrown, looks up each frame's unwind info
+// through dl_iterate_phdr() (except on arm32, which uses dl_unwind_find_exidx()).
+static size_t bm_unwind() {
+  size_t frames = 0;
+  _Unwind_Backtrace(bm_unwind_count_frame, &frames);
+  return frames;
+}
+
+BIONIC_TRIVIAL_BENCHMARK(BM_dl_iterate_phdr, bm_dl_iterate_phdr());
+
+// Many threads unwinding at once, as in exception-heavy servers.
+BM_DLFCN_CONTENDED(dl_iterate_phdr_with_dl_iterate_phdr, bm_dl_iterate_phdr,
+                   []() { bm_dl_iterate_phdr(); }, 4);
+BM_DLFCN_CONTENDED(unwind_with_unwind, bm_unwind, []() { bm_unwind(); }, 1);
+BM_DLFCN_CONTENDED(unwind_with_unwind, bm_unwind, []() { bm_unwind(); }, 4);
+BM_DLFCN_CONTENDED(unwind_with_unwind, bm_unwind, []() { bm_unwind(); }, 8);
+
+// Unwinding while other threads keep loading and unloading libraries.
+BM_DLFCN_CONTENDED(unwind_with_dlopen, bm_unwind, bm_dlopen_dlclose_libc, 1);
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+// A library with a large text segment whose functions each sit on their own 4KiB page, so that
+// walking a chain of calls through them touches a different page of code at every hop. It is
+// built twice, with and without 2MiB segment alignment, to compare iTLB-sensitive call chains
+// in code the linker could (or could not) back with transparent huge pages.
+
+#include <stddef.h>
+
+typedef int (*hop_fn)(int);
+
+#define HOP(n) \
+  __attribute__((noinline, aligned(4096))) static int hop_##n(int x) { return x * 31 + 0##n; }
+#define HOP_4(p) HOP(p##0) HOP(p##1) HOP(p##2) HOP(p##3)
+#define HOP_16(p) HOP_4(p##0) HOP_4(p##1) HOP_4(p##2) HOP_4(p##3)
+#define HOP_64(p) HOP_16(p##0) HOP_16(p##1) HOP_16(p##2) HOP_16(p##3)
+#define HOP_256(p) HOP_64(p##0) HOP_64(p##1) HOP_64(p##2) HOP_64(p##3)
+#define HOP_1024() HOP_256(0) HOP_256(1) HOP_256(2) HOP_256(3)
+
+#define REF(n) hop_##n,
+#define REF_4(p) REF(p##0) REF(p##1) REF(p##2) REF(p##3)
+#define REF_16(p) REF_4(p##0) REF_4(p##1) REF_4(p##2) REF_4(p##3)
+#define REF_64(p) REF_16(p##0) REF_16(p##1) REF_16(p##2) REF_16(p##3)
+#define REF_256(p) REF_64(p##0) REF_64(p##1) REF_64(p##2) REF_64(p##3)
+#define REF_1024() REF_256(0) REF_256(1) REF_256(2) REF_256(3)
+
+HOP_1024()
+
+static hop_fn const kHops[] = { REF_1024() };
+static constexpr size_t kHopCount = sizeof(kHops) / sizeof(kHops[0]);
+
+// Makes `hops` calls, visiting the functions in a stride that defeats next-page prefetching.
+extern "C" int itlb_chain_run(int x, size_t hops) {
+  size_t i = 0;
+  for (size_t n = 0; n < hops; ++n) {
+    x = kHops[i](x);
+    i = (i + 389) % kHopCount;
+  }
+  return x;
+}
@@ -26,7 +26,20 @@
  * SUCH DAMAGE.
  */
 
+#include <dlfcn.h>
+#include <linux/perf_event.h>
+#include <spawn.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <filesystem>
+
+#include <android-base/file.h>
+#include <android-base/unique_fd.h>
+#include <ziparchive/zip_writer.h>
 
 #include "spawn_benchmark.h"
 
@@ -36,22 +49,207 @@ static constexpr const char* kNativeTestDir = "nativetest64";
 static constexpr const char* kNativeTestDir = "nativetest";
 #endif
 
-static void BM_linker_relocation(benchmark::State& state) {
-  std::string main = test_program("linker_reloc_bench_main");
-
+static std::string test_lib_dir() {
   // Translate from:
   //    /data/benchmarktest[64]/linker-reloc-bench    [exe dir]
   // to:
   //    /data/nativetest[64]/linker-reloc-bench       [dir with test libs]
-  std::string test_lib_dir = 
-      android::base::Dirname(android::base::Dirname(android::base::GetExecutableDirectory())) +
+  return android::base::Dirname(android::base::Dirname(android::base::GetExecutableDirectory())) +
       "/" + kNativeTestDir + "/linker-reloc-bench";
+}
 
-  setenv("LD_LIBRARY_PATH", test_lib_dir.c_str(), 1);
+static void BM_linker_relocation(benchmark::State& state) {
+  std::string main = test_program("linker_reloc_bench_main");
+
+  setenv("LD_LIBRARY_PATH", test_lib_dir().c_str(), 1);
+  unsetenv("LD_RELOC_CACHE_DIR");
 
   BM_spawn_test(state, (const char*[]) { main.c_str(), nullptr });
 }
 
 BENCHMARK(BM_linker_relocation)->UseRealTime()->Unit(benchmark::kMicrosecond);
 
+// The same start, with LD_PREFAULT_SEGMENTS faulting in text and RELRO as libraries are mapped.
+// Compare the minor_faults/major_faults counters with BM_linker_relocation.
+static void BM_linker_relocation_prefault(benchmark::State& state, const char* mode) {
+  std::string main = test_program("linker_reloc_bench_main");
+
+  setenv("LD_LIBRARY_PATH", test_lib_dir().c_str(), 1);
+  unsetenv("LD_RELOC_CACHE_DIR");
+  setenv("LD_PREFAULT_SEGMENTS", mode, 1);
+
+  BM_spawn_test(state, (const char*[]) { main.c_str(), nullptr });
+  unsetenv("LD_PREFAULT_SEGMENTS");
+}
+
+BENCHMARK_CAPTURE(BM_linker_relocation_prefault, willneed, "willneed")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_linker_relocation_prefault, populate, "populate")
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+// Every iteration records the binding cache from scratch: the cost of a cold start with
+// LD_RELOC_CACHE_DIR set.
+static void BM_linker_relocation_binding_cache_cold(benchmark::State& state) {
+  std::string main = test_program("linker_reloc_bench_main");
+
+  TemporaryDir cache_dir;
+  setenv("LD_LIBRARY_PATH", test_lib_dir().c_str(), 1);
+  setenv("LD_RELOC_CACHE_DIR", cache_dir.path, 1);
+
+  const char* argv[] = { main.c_str(), nullptr };
+  for (auto _ : state) {
+    state.PauseTiming();
+    for (const auto& entry : std::filesystem::directory_iterator(cache_dir.path)) {
+      std::filesystem::remove(entry.path());
+    }
+    state.ResumeTiming();
+    pid_t child = 0;
+    if (posix_spawn(&child, argv[0], nullptr, nullptr, const_cast<char**>(argv), environ) != 0 ||
+        TEMP_FAILURE_RETRY(waitpid(child, nullptr, 0)) != child) {
+      state.SkipWithError("failed to run linker_reloc_bench_main");
+      break;
+    }
+  }
+  unsetenv("LD_RELOC_CACHE_DIR");
+}
+
+BENCHMARK(BM_linker_relocation_binding_cache_cold)->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+// Every iteration is served by a binding cache primed by an earlier run.
+static void BM_linker_relocation_binding_cache_warm(benchmark::State& state) {
+  std::string main = test_program("linker_reloc_bench_main");
+
+  TemporaryDir cache_dir;
+  setenv("LD_LIBRARY_PATH", test_lib_dir().c_str(), 1);
+  setenv("LD_RELOC_CACHE_DIR", cache_dir.path, 1);
+
+  // Prime the cache.
+  const char* argv[] = { main.c_str(), nullptr };
+  pid_t child = 0;
+  if (posix_spawn(&child, argv[0], nullptr, nullptr, const_cast<char**>(argv), environ) != 0 ||
+      TEMP_FAILURE_RETRY(waitpid(child, nullptr, 0)) != child) {
+    state.SkipWithError("failed to prime the binding cache");
+    return;
+  }
+
+  BM_spawn_test(state, argv);
+  unsetenv("LD_RELOC_CACHE_DIR");
+}
+
+BENCHMARK(BM_linker_relocation_binding_cache_warm)->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+// Calls through a chain of functions spread one per page across 4MiB of text. The
+// hugepage_aligned variant of the library has 2MiB-aligned segments, which lets the linker
+// align its text so that the kernel can back it with file THPs, cutting iTLB misses.
+static void BM_itlb_call_chain(benchmark::State& state, const char* lib_name) {
+  std::string path = test_lib_dir() + "/" + lib_name;
+  void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (handle == nullptr) {
+    state.SkipWithError(dlerror());
+    return;
+  }
+  auto run = reinterpret_cast<int (*)(int, size_t)>(dlsym(handle, "itlb_chain_run"));
+  if (run == nullptr) {
+    state.SkipWithError(dlerror());
+    dlclose(handle);
+    return;
+  }
+
+  constexpr size_t kHops = 4096;
+  int x = 1;
+  for (auto _ : state) {
+    x = run(x, kHops);
+    benchmark::DoNotOptimize(x);
+  }
+  state.SetItemsProcessed(state.iterations() * kHops);
+  dlclose(handle);
+}
+
+BENCHMARK_CAPTURE(BM_itlb_call_chain, default, "libitlb_chain_bench.so");
+BENCHMARK_CAPTURE(BM_itlb_call_chain, hugepage_aligned, "libitlb_chain_bench_hugepage_aligned.so");
+
+// Counts this thread's calls to a system call through the kernel's syscall tracepoints. These
+// aren't available to every process (or to 32-bit processes on 64-bit kernels), in which case
+// ok() is false.
+class SyscallCounter {
+ public:
+  explicit SyscallCounter(const char* name) {
+    std::string id;
+    if (!android::base::ReadFileToString(
+            std::string("/sys/kernel/tracing/events/syscalls/sys_enter_") + name + "/id", &id)) {
+      return;
+    }
+    perf_event_attr attr = {};
+    attr.type = PERF_TYPE_TRACEPOINT;
+    attr.size = sizeof(attr);
+    attr.config = strtoull(id.c_str(), nullptr, 10);
+    fd_.reset(syscall(__NR_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+  }
+
+  bool ok() const { return fd_ != -1; }
+
+  uint64_t count() const {
+    uint64_t count = 0;
+    if (read(fd_, &count, sizeof(count)) != sizeof(count)) return 0;
+    return count;
+  }
+
+ private:
+  android::base::unique_fd fd_;
+};
+
+// Stores `data` uncompressed and page-aligned as `entry_name` in a new zip file, the way libraries
+// are stored in an APK so that they can be loaded straight from it.
+static bool write_stored_zip(const std::string& zip_path, const char* entry_name,
+                             const std::string& data) {
+  FILE* fp = fopen(zip_path.c_str(), "we");
+  if (fp == nullptr) return false;
+  ZipWriter writer(fp);
+  bool ok = writer.StartAlignedEntry(entry_name, 0, getpagesize()) == 0 &&
+            writer.WriteBytes(data.data(), data.size()) == 0 && writer.FinishEntry() == 0 &&
+            writer.Finish() == 0;
+  return fclose(fp) == 0 && ok;
+}
+
+// dlopen()s and dlclose()s a library loaded from inside a zip file. The mmap/munmap counters
+// report the system calls made per iteration, when they can be counted.
+static void BM_dlopen_from_zip(benchmark::State& state) {
+  constexpr const char* kLibName = "libitlb_chain_bench.so";
+  std::string lib;
+  if (!android::base::ReadFileToString(test_lib_dir() + "/" + kLibName, &lib)) {
+    state.SkipWithError("failed to read the test library");
+    return;
+  }
+  TemporaryDir dir;
+  std::string zip_path = std::string(dir.path) + "/libs.zip";
+  if (!write_stored_zip(zip_path, kLibName, lib)) {
+    state.SkipWithError("failed to write the zip file");
+    return;
+  }
+  std::string path = zip_path + "!/" + kLibName;
+
+  SyscallCounter mmaps("mmap");
+  SyscallCounter munmaps("munmap");
+  uint64_t mmaps_before = mmaps.count();
+  uint64_t munmaps_before = munmaps.count();
+  for (auto _ : state) {
+    void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (handle == nullptr) {
+      state.SkipWithError(dlerror());
+      break;
+    }
+    dlclose(handle);
+  }
+  if (mmaps.ok() && munmaps.ok()) {
+    state.counters["mmap"] = benchmark::Counter(mmaps.count() - mmaps_before,
+                                                benchmark::Counter::kAvgIterations);
+    state.counters["munmap"] = benchmark::Counter(munmaps.count() - munmaps_before,
+                                                  benchmark::Counter::kAvgIterations);
+  }
+}
+
+BENCHMARK(BM_dlopen_from_zip)->Unit(benchmark::kMicrosecond);
+
 BENCHMARK_MAIN();
@@ -31,6 +31,7 @@
 #include <errno.h>
 #include <spawn.h>
 #include <string.h>
+#include <sys/resource.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 
@@ -39,6 +40,9 @@
 extern char** environ;
 
 void BM_spawn_test(benchmark::State& state, const char* const* argv) {
+  // Page faults taken by the children, reported per iteration.
+  long minor_faults = 0;
+  long major_faults = 0;
   for (auto _ : state) {
     pid_t child = 0;
     if (int spawn_err = posix_spawn(&child, argv[0], nullptr, nullptr, const_cast<char**>(argv),
@@ -49,7 +53,8 @@ void BM_spawn_test(benchmark::State& state, const char* const* argv) {
     }
 
     int wstatus = 0;
-    const pid_t wait_result = TEMP_FAILURE_RETRY(waitpid(child, &wstatus, 0));
+    rusage usage = {};
+    const pid_t wait_result = TEMP_FAILURE_RETRY(wait4(child, &wstatus, 0, &usage));
     if (wait_result != child) {
       state.SkipWithError(android::base::StringPrintf(
           "waitpid on pid %d for %s failed: %s",
@@ -60,5 +65,11 @@ void BM_spawn_test(benchmark::State& state, const char* const* argv) {
       state.SkipWithError(android::base::StringPrintf("could not exec %s", argv[0]).c_str());
       break;
     }
+    minor_faults += usage.ru_minflt;
+    major_faults += usage.ru_majflt;
   }
+  state.counters["minor_faults"] =
+      benchmark::Counter(minor_faults, benchmark::Counter::kAvgIterations);
+  state.counters["major_faults"] =
+      benchmark::Counter(major_faults, benchmark::Counter::kAvgIterations);
 }
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <link.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <benchmark/benchmark.h>
+#include "util.h"
+
+// The __tls_get_addr argument. Both bionic and glibc use this layout.
+struct TlsIndex {
+  size_t module_id;
+  size_t offset;
+};
+
+#if defined(__i386__)
+extern "C" void* ___tls_get_addr(const TlsIndex* ti) __attribute__((regparm(1)));
+#define TLS_GET_ADDR ___tls_get_addr
+#else
+extern "C" void* __tls_get_addr(const TlsIndex* ti);
+#define TLS_GET_ADDR __tls_get_addr
+#endif
+
+static thread_local int g_tls_var;
+
+// Accesses to g_tls_var from the executable are always relaxed to the local-exec model, so an
+// access is a constant offset from the thread pointer. This is the baseline a dynamic access
+// is compared against.
+static void BM_tls_static(benchmark::State& state) {
+  for (auto _ : state) {
+    int* p = &g_tls_var;
+    benchmark::DoNotOptimize(p);
+    ++*p;
+  }
+}
+BIONIC_BENCHMARK(BM_tls_static);
+
+static int find_exe_tls_index(dl_phdr_info* info, size_t, void* data) {
+  // The executable is always reported first.
+  TlsIndex* ti = static_cast<TlsIndex*>(data);
+  ti->module_id = info->dlpi_tls_modid;
+  ti->offset = reinterpret_cast<uintptr_t>(&g_tls_var) -
+               reinterpret_cast<uintptr_t>(info->dlpi_tls_data);
+#if defined(__riscv)
+  // riscv64's __tls_get_addr adds TLS_DTV_OFFSET to the offset it's given.
+  ti->offset -= 0x800;
+#endif
+  return 1;
+}
+
+// Calls __tls_get_addr directly, as code using the general-dynamic TLS model in a shared library
+// would on every access (or, on targets with TLSDESC, on the first access from each thread). The
+// executable's TLS segment is used so that the benchmark doesn't need a helper library, but the
+// lookup goes through the same DTV fast path as a dlopen'ed library's.
+static void BM_tls_get_addr(benchmark::State& state) {
+  TlsIndex ti = {};
+  // Make sure this thread's static TLS block is set up before asking for its address.
+  g_tls_var = 0;
+  dl_iterate_phdr(find_exe_tls_index, &ti);
+  if (ti.module_id == 0) {
+    state.SkipWithError("executable has no TLS module");
+    return;
+  }
+  for (auto _ : state) {
+    int* p = static_cast<int*>(TLS_GET_ADDR(&ti));
+    benchmark::DoNotOptimize(p);
+    ++*p;
+  }
+}
+BIONIC_BENCHMARK(BM_tls_get_addr);
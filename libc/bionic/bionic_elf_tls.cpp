@@ -296,6 +296,97 @@ static size_t calculate_new_dtv_count() {
   return (bytes - sizeof(TlsDtv)) / sizeof(void*);
 }
 
+// Threads that exit hand their DTV and dynamic TLS blocks to a per-process
+// pool instead of back to the allocator, so that a process that keeps creating
+// short-lived threads doesn't go back to the allocator on each new thread's
+// first access to each module. The pool is
+// bounded so that a one-off burst of threads doesn't pin memory forever, and
+// large blocks (which the allocator maps and unmaps individually anyway) are
+// never pooled.
+static constexpr size_t kDynamicTlsPoolLimit = 32;
+static constexpr size_t kDynamicTlsPoolMaxBlockSize = 16 * 1024;
+
+// Returns a DTV with room for at least new_cnt modules, with every slot null.
+//
+// The lock on TlsModules must be held.
+static TlsDtv* alloc_dtv(size_t new_cnt) {
+  TlsModules& modules = __libc_shared_globals()->tls_modules;
+  BionicAllocator& allocator = __libc_shared_globals()->tls_allocator;
+
+  TlsDtv* dtv = modules.free_dtvs;
+  if (dtv != nullptr) {
+    modules.free_dtvs = dtv->next;
+    --modules.free_dtv_count;
+    // The module count never shrinks, so a pooled DTV that is too small now
+    // won't ever be useful again.
+    if (dtv->count >= new_cnt) {
+      size_t cnt = dtv->count;
+      memset(dtv, 0, dtv_size_in_bytes(cnt));
+      dtv->count = cnt;
+      return dtv;
+    }
+    allocator.free(dtv);
+  }
+  dtv = static_cast<TlsDtv*>(allocator.alloc(dtv_size_in_bytes(new_cnt)));
+  dtv->count = new_cnt;
+  return dtv;
+}
+
+// Returns a freshly initialized TLS block for the given module.
+//
+// The lock on TlsModules must be held.
+static void* alloc_dynamic_tls_block(TlsModule& mod) {
+  const TlsSegment& segment = mod.segment;
+  void* block = mod.free_blocks;
+  if (block != nullptr) {
+    mod.free_blocks = *static_cast<void**>(block);
+    --mod.free_block_count;
+    // Blocks from the allocator come back zeroed; match that for .tbss.
+    memset(static_cast<char*>(block) + segment.init_size, 0,
+           segment.aligned_size.size - segment.init_size);
+  } else {
+    // TODO: Currently the aligned_size.align.skew property is ignored.
+    // That is, for a dynamic TLS block at addr A, (A % p_align) will be 0, not
+    // (p_vaddr % p_align).
+    block = __libc_shared_globals()->tls_allocator.memalign(segment.aligned_size.align.value,
+                                                            segment.aligned_size.size);
+  }
+  if (segment.init_size > 0) {
+    memcpy(block, segment.init_ptr, segment.init_size);
+  }
+  return block;
+}
+
+// Releases a TLS block that belongs to a module that is still loaded. The
+// destruction listener must already have been told about the block.
+//
+// The lock on TlsModules must be held.
+static void release_dynamic_tls_block(TlsModule& mod, void* block) {
+  const size_t size = mod.segment.aligned_size.size;
+  if (mod.free_block_count < kDynamicTlsPoolLimit && size >= sizeof(void*) &&
+      size <= kDynamicTlsPoolMaxBlockSize) {
+    *static_cast<void**>(block) = mod.free_blocks;
+    mod.free_blocks = block;
+    ++mod.free_block_count;
+    return;
+  }
+  __libc_shared_globals()->tls_allocator.free(block);
+}
+
+// Frees the pooled TLS blocks of a module that is being unloaded.
+//
+// This function must be called with signals blocked and a write lock on
+// TlsModules held.
+void __free_tls_module_pool(TlsModule& mod) {
+  BionicAllocator& allocator = __libc_shared_globals()->tls_allocator;
+  while (mod.free_blocks != nullptr) {
+    void* next = *static_cast<void**>(mod.free_blocks);
+    allocator.free(mod.free_blocks);
+    mod.free_blocks = next;
+  }
+  mod.free_block_count = 0;
+}
+
 // This function must be called with signals blocked and a write lock on
 // TlsModules held.
 static void update_tls_dtv(bionic_tcb* tcb) {
@@ -317,9 +408,9 @@ static void update_tls_dtv(bionic_tcb* tcb) {
   // DTVs at thread-exit. Each time the DTV is reallocated, its size at least
   // doubles.
   if (modules.module_count > old_cnt) {
-    size_t new_cnt = calculate_new_dtv_count();
     TlsDtv* const old_dtv = __get_tcb_dtv(tcb);
-    TlsDtv* const new_dtv = static_cast<TlsDtv*>(allocator.alloc(dtv_size_in_bytes(new_cnt)));
+    TlsDtv* const new_dtv = alloc_dtv(calculate_new_dtv_count());
+    const size_t new_cnt = new_dtv->count;
     memcpy(new_dtv, old_dtv, dtv_size_in_bytes(old_cnt));
     new_dtv->count = new_cnt;
     new_dtv->next = old_dtv;
@@ -372,15 +463,9 @@ __attribute__((noinline)) static void* tls_get_addr_slow_path(const TlsIndex* ti
   const size_t module_idx = __tls_module_id_to_idx(ti->module_id);
   void* mod_ptr = dtv->modules[module_idx];
   if (mod_ptr == nullptr) {
-    const TlsSegment& segment = modules.module_table[module_idx].segment;
-    // TODO: Currently the aligned_size.align.skew property is ignored.
-    // That is, for a dynamic TLS block at addr A, (A % p_align) will be 0, not
-    // (p_vaddr % p_align).
-    mod_ptr = __libc_shared_globals()->tls_allocator.memalign(segment.aligned_size.align.value,
-                                                              segment.aligned_size.size);
-    if (segment.init_size > 0) {
-      memcpy(mod_ptr, segment.init_ptr, segment.init_size);
-    }
+    TlsModule& mod = modules.module_table[module_idx];
+    const TlsSegment& segment = mod.segment;
+    mod_ptr = alloc_dynamic_tls_block(mod);
     dtv->modules[module_idx] = mod_ptr;
 
     // Reports the allocation to the listener, if any.
@@ -404,10 +489,13 @@ __attribute__((noinline)) static void* tls_get_addr_slow_path(const TlsIndex* ti
 // ___tls_get_addr (with three underscores) instead, and a regparm
 // calling convention.
 extern "C" void* TLS_GET_ADDR(const TlsIndex* ti) TLS_GET_ADDR_CALLING_CONVENTION {
-  TlsDtv* dtv = __get_tcb_dtv(__get_bionic_tcb());
+  TlsDtv* dtv = __get_current_dtv();
 
-  // TODO: See if we can use a relaxed memory ordering here instead.
-  size_t generation = atomic_load(&__libc_tls_generation_copy);
+  // A relaxed load is enough here. The DTV and the blocks it points at are only ever written by the
+  // calling thread (in tls_get_addr_slow_path), so a matching generation means the slot was already
+  // filled in by this thread. A stale generation just sends us down the slow path, which takes the
+  // loader's lock and synchronizes properly with dlopen/dlclose.
+  size_t generation = atomic_load_explicit(&__libc_tls_generation_copy, memory_order_relaxed);
   if (__predict_true(generation == dtv->generation)) {
     void* mod_ptr = dtv->modules[__tls_module_id_to_idx(ti->module_id)];
     if (__predict_true(mod_ptr != nullptr)) {
@@ -437,7 +525,8 @@ void __free_dynamic_tls(bionic_tcb* tcb) {
   // We need the write lock to use the allocator.
   ScopedWriteLock locker(&modules.rwlock);
 
-  // First free everything in the current DTV.
+  // First release everything in the current DTV. Blocks of modules that are
+  // still loaded go back to their module's pool.
   for (size_t i = 0; i < dtv->count; ++i) {
     if (i < modules.module_count && modules.module_table[i].static_offset != SIZE_MAX) {
       // This module's TLS memory is allocated statically, so don't free it here.
@@ -451,10 +540,28 @@ void __free_dynamic_tls(bionic_tcb* tcb) {
       modules.on_destruction_cb(dtls_begin, dtls_end);
     }
 
+    if (dtv->modules[i] != nullptr && i < modules.module_count) {
+      TlsModule& mod = modules.module_table[i];
+      // A module loaded after this DTV was last updated reuses the slot of an
+      // unloaded one, so the block isn't the right size for it.
+      if (mod.first_generation != kTlsGenerationNone &&
+          mod.first_generation <= dtv->generation) {
+        release_dynamic_tls_block(mod, dtv->modules[i]);
+        continue;
+      }
+    }
     allocator.free(dtv->modules[i]);
   }
 
-  // Now free the thread's list of DTVs.
+  // Now release the thread's list of DTVs. The newest one is the largest, so
+  // that's the one worth keeping for another thread.
+  if (modules.free_dtv_count < kDynamicTlsPoolLimit) {
+    TlsDtv* next = dtv->next;
+    dtv->next = modules.free_dtvs;
+    modules.free_dtvs = dtv;
+    ++modules.free_dtv_count;
+    dtv = next;
+  }
   while (dtv->generation != kTlsGenerationNone) {
     TlsDtv* next = dtv->next;
     allocator.free(dtv);
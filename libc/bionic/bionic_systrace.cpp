@@ -135,6 +135,20 @@ void bionic_trace_end() {
   tls.bionic_systrace_disabled = false;
 }
 
+bool bionic_trace_enabled() {
+  // should_trace() can call into code that traces; see bionic_trace_begin().
+  bionic_tls& tls = __get_bionic_tls();
+  if (tls.bionic_systrace_disabled) {
+    return false;
+  }
+  tls.bionic_systrace_disabled = true;
+
+  bool enabled = should_trace();
+
+  tls.bionic_systrace_disabled = false;
+  return enabled;
+}
+
 ScopedTrace::ScopedTrace(const char* message) : called_end_(false) {
   bionic_trace_begin(message);
 }
@@ -315,15 +315,20 @@ static bool __is_unsafe_environment_variable(const char* name) {
       "LD_AOUT_LIBRARY_PATH",
       "LD_AOUT_PRELOAD",
       "LD_AUDIT",
+      "LD_BIND_LAZY",
       "LD_CONFIG_FILE",
+      "LD_CONFIG_WRITE_COMPILED",
       "LD_DEBUG",
       "LD_DEBUG_OUTPUT",
       "LD_DYNAMIC_WEAK",
       "LD_HWASAN",
       "LD_LIBRARY_PATH",
       "LD_ORIGIN_PATH",
+      "LD_PREFAULT_SEGMENTS",
+      "LD_PREFETCH_DEPENDENCIES",
       "LD_PRELOAD",
       "LD_PROFILE",
+      "LD_RELOC_CACHE_DIR",
       "LD_SHOW_AUXV",
       "LD_USE_LOAD_BIAS",
       "LIBC_DEBUG_MALLOC_OPTIONS",
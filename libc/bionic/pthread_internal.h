@@ -240,6 +240,21 @@ static inline void __set_tcb_dtv(bionic_tcb* tcb, TlsDtv* val) {
   tcb->tls_slot(TLS_SLOT_DTV) = &val->generation;
 }
 
+// Returns the calling thread's DTV. On x86, the DTV slot can be read with a single segment-relative
+// load instead of first loading the thread pointer and then indexing off it.
+static inline __always_inline TlsDtv* __get_current_dtv() {
+#if defined(__x86_64__)
+  uintptr_t dtv_slot;
+  __asm__("movq %%fs:%c1, %0" : "=r"(dtv_slot) : "i"(TLS_SLOT_DTV * sizeof(void*)));
+#elif defined(__i386__)
+  uintptr_t dtv_slot;
+  __asm__("movl %%gs:%c1, %0" : "=r"(dtv_slot) : "i"(TLS_SLOT_DTV * sizeof(void*)));
+#else
+  uintptr_t dtv_slot = reinterpret_cast<uintptr_t>(__get_tls()[TLS_SLOT_DTV]);
+#endif
+  return reinterpret_cast<TlsDtv*>(dtv_slot - offsetof(TlsDtv, generation));
+}
+
 __LIBC_HIDDEN__ void pthread_key_clean_all(void);
 
 // Address space is precious on LP32, so use the minimum unit: one page.
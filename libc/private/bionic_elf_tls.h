@@ -136,6 +136,12 @@ struct TlsModule {
 
   // Used by the dynamic linker to track the associated soinfo* object.
   void* soinfo_ptr = nullptr;
+
+  // Dynamic TLS blocks released by exited threads, kept for reuse by later
+  // threads. The list is linked through the first word of each block. Guarded
+  // by TlsModules::rwlock.
+  void* free_blocks = nullptr;
+  size_t free_block_count = 0;
 };
 
 // Signature of the callbacks that will be called after DTLS creation and
@@ -145,6 +151,8 @@ typedef void (*dtls_listener_t)(void* dynamic_tls_begin, void* dynamic_tls_end);
 // Signature of the thread-exit callbacks.
 typedef void (*thread_exit_cb_t)(void);
 
+struct TlsDtv;
+
 struct CallbackHolder {
   thread_exit_cb_t cb;
   CallbackHolder* prev;
@@ -181,6 +189,11 @@ struct TlsModules {
 
   // The additional callbacks, if any.
   CallbackHolder* thread_exit_callback_tail_node = nullptr;
+
+  // DTVs released by exited threads, linked through TlsDtv::next and kept for
+  // reuse by later threads.
+  TlsDtv* free_dtvs = nullptr;
+  size_t free_dtv_count = 0;
 };
 
 void __init_static_tls(void* static_tls);
@@ -204,8 +217,8 @@ struct TlsDtv {
   TlsDtv* next;
 
   // The DTV slot points at this field, which allows omitting an add instruction
-  // on the fast path for a TLS lookup. The arm64 tlsdesc_resolver.S depends on
-  // the layout of fields past this point.
+  // on the fast path for a TLS lookup. The arm64 and x86_64 tlsdesc_resolver.S
+  // files depend on the layout of fields past this point.
   size_t generation;
   void* modules[];
 };
@@ -227,5 +240,6 @@ extern "C" void* TLS_GET_ADDR(const TlsIndex* ti) TLS_GET_ADDR_CALLING_CONVENTIO
 
 struct bionic_tcb;
 void __free_dynamic_tls(bionic_tcb* tcb);
+void __free_tls_module_pool(TlsModule& mod);
 void __notify_thread_exit_callbacks();
 
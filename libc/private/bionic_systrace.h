@@ -35,3 +35,6 @@ class __LIBC_HIDDEN__ ScopedTrace {
 
 void bionic_trace_begin(const char* message);
 void bionic_trace_end();
+// Returns true if bionic tracing is currently enabled, so callers can skip building a message
+// that would be thrown away.
+bool bionic_trace_enabled();
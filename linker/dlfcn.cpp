@@ -42,7 +42,6 @@
 #include <bionic/pthread_internal.h>
 #include "private/bionic_globals.h"
 #include "private/bionic_tls.h"
-#include "private/ScopedPthreadMutexLocker.h"
 
 #define __LINKER_PUBLIC__ __attribute__((visibility("default")))
 
@@ -99,6 +98,9 @@ bool __loader_android_handle_signal(int signal_number, siginfo_t* info,
 }
 
 pthread_mutex_t g_dl_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+size_t g_dl_mutex_depth = 0;
+pthread_rwlock_t g_dl_rwlock = PTHREAD_RWLOCK_INITIALIZER;
+size_t g_dl_write_lock_depth = 0;
 
 static char* __bionic_set_dlerror(char* new_value) {
   char* old_value = __get_thread()->current_dlerror;
@@ -125,12 +127,12 @@ char* __loader_dlerror() {
 }
 
 void __loader_android_get_LD_LIBRARY_PATH(char* buffer, size_t buffer_size) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlMutexLock locker;
   do_android_get_LD_LIBRARY_PATH(buffer, buffer_size);
 }
 
 void __loader_android_update_LD_LIBRARY_PATH(const char* ld_library_path) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlMutexLock locker;
   do_android_update_LD_LIBRARY_PATH(ld_library_path);
 }
 
@@ -138,8 +140,14 @@ static void* dlopen_ext(const char* filename,
                         int flags,
                         const android_dlextinfo* extinfo,
                         const void* caller_addr) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlMutexLock locker;
   g_linker_logger.ResetState();
+  // Taking another reference to a loaded library doesn't change anything dlsym() or dladdr() can
+  // see, so it doesn't need to wait for them.
+  void* handle = do_dlopen_loaded(filename, flags, extinfo, caller_addr);
+  if (handle != nullptr) return handle;
+
+  ScopedDlWriteLock write_locker;
   void* result = do_dlopen(filename, flags, extinfo, caller_addr);
   if (result == nullptr) {
     __bionic_format_dlerror("dlopen failed", linker_get_error_buffer());
@@ -160,9 +168,17 @@ void* __loader_dlopen(const char* filename, int flags, const void* caller_addr)
 }
 
 void* dlsym_impl(void* handle, const char* symbol, const char* version, const void* caller_addr) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
-  g_linker_logger.ResetState();
+  // Successful lookups don't modify loader state, so try them under the read lock first. This
+  // fails with EDEADLK if this thread is itself in the middle of a dlopen() or dlclose().
   void* result;
+  if (pthread_rwlock_rdlock(&g_dl_rwlock) == 0) {
+    bool success = do_dlsym_shared(handle, symbol, version, caller_addr, &result);
+    pthread_rwlock_unlock(&g_dl_rwlock);
+    if (success) return result;
+  }
+
+  ScopedDlMutexLock locker;
+  g_linker_logger.ResetState();
   if (!do_dlsym(handle, symbol, version, caller_addr, &result)) {
     __bionic_format_dlerror(linker_get_error_buffer(), nullptr);
     return nullptr;
@@ -180,12 +196,21 @@ void* __loader_dlvsym(void* handle, const char* symbol, const char* version, con
 }
 
 int __loader_dladdr(const void* addr, Dl_info* info) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  if (pthread_rwlock_rdlock(&g_dl_rwlock) == 0) {
+    int result = do_dladdr(addr, info);
+    pthread_rwlock_unlock(&g_dl_rwlock);
+    return result;
+  }
+
+  ScopedDlMutexLock locker;
   return do_dladdr(addr, info);
 }
 
 int __loader_dlclose(void* handle) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlMutexLock locker;
+  if (do_dlclose_loaded(handle)) return 0;
+
+  ScopedDlWriteLock write_locker;
   int result = do_dlclose(handle);
   if (result != 0) {
     __bionic_format_dlerror("dlclose failed", linker_get_error_buffer());
@@ -194,20 +219,24 @@ int __loader_dlclose(void* handle) {
 }
 
 int __loader_dl_iterate_phdr(int (*cb)(dl_phdr_info* info, size_t size, void* data), void* data) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  int result;
+  if (do_dl_iterate_phdr_lockfree(cb, data, &result)) {
+    return result;
+  }
+  ScopedDlMutexLock locker;
   return do_dl_iterate_phdr(cb, data);
 }
 
 #if defined(__arm__)
 _Unwind_Ptr __loader_dl_unwind_find_exidx(_Unwind_Ptr pc, int* pcount) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlMutexLock locker;
   return do_dl_unwind_find_exidx(pc, pcount);
 }
 #endif
 
 void __loader_android_set_application_target_sdk_version(int target) {
   // lock to avoid modification in the middle of dlopen.
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlMutexLock locker;
   set_application_target_sdk_version(target);
 }
 
@@ -216,13 +245,14 @@ int __loader_android_get_application_target_sdk_version() {
 }
 
 void __loader_android_dlwarning(void* obj, void (*f)(void*, const char*)) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlMutexLock locker;
   get_dlwarning(obj, f);
 }
 
 bool __loader_android_init_anonymous_namespace(const char* shared_libs_sonames,
                                                const char* library_search_path) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlMutexLock locker;
+  ScopedDlWriteLock write_locker;
   bool success = init_anonymous_namespace(shared_libs_sonames, library_search_path);
   if (!success) {
     __bionic_format_dlerror("android_init_anonymous_namespace failed", linker_get_error_buffer());
@@ -238,7 +268,8 @@ android_namespace_t* __loader_android_create_namespace(const char* name,
                                                 const char* permitted_when_isolated_path,
                                                 android_namespace_t* parent_namespace,
                                                 const void* caller_addr) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlMutexLock locker;
+  ScopedDlWriteLock write_locker;
 
   android_namespace_t* result = create_namespace(caller_addr,
                                                  name,
@@ -258,7 +289,8 @@ android_namespace_t* __loader_android_create_namespace(const char* name,
 bool __loader_android_link_namespaces(android_namespace_t* namespace_from,
                                       android_namespace_t* namespace_to,
                                       const char* shared_libs_sonames) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlMutexLock locker;
+  ScopedDlWriteLock write_locker;
 
   bool success = link_namespaces(namespace_from, namespace_to, shared_libs_sonames);
 
@@ -271,7 +303,8 @@ bool __loader_android_link_namespaces(android_namespace_t* namespace_from,
 
 bool __loader_android_link_namespaces_all_libs(android_namespace_t* namespace_from,
                                                android_namespace_t* namespace_to) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlMutexLock locker;
+  ScopedDlWriteLock write_locker;
 
   bool success = link_namespaces_all_libs(namespace_from, namespace_to);
 
@@ -283,27 +316,29 @@ bool __loader_android_link_namespaces_all_libs(android_namespace_t* namespace_fr
 }
 
 android_namespace_t* __loader_android_get_exported_namespace(const char* name) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlMutexLock locker;
   return get_exported_namespace(name);
 }
 
 void __loader_cfi_fail(uint64_t CallSiteTypeId, void* Ptr, void *DiagData, void *CallerPc) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlMutexLock locker;
   CFIShadowWriter::CfiFail(CallSiteTypeId, Ptr, DiagData, CallerPc);
 }
 
 void __loader_add_thread_local_dtor(void* dso_handle) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlMutexLock locker;
+  ScopedDlWriteLock write_locker;
   increment_dso_handle_reference_counter(dso_handle);
 }
 
 void __loader_remove_thread_local_dtor(void* dso_handle) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlMutexLock locker;
+  ScopedDlWriteLock write_locker;
   decrement_dso_handle_reference_counter(dso_handle);
 }
 
 void __loader_android_set_16kb_appcompat_mode(bool enable_app_compat) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlMutexLock locker;
   set_16kb_appcompat_mode(enable_app_compat);
 }
 
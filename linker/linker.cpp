@@ -31,6 +31,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
+#include <limits.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -41,9 +42,12 @@
 #include <sys/vfs.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <iterator>
 #include <new>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -63,11 +67,16 @@
 #include "linker_globals.h"
 #include "linker_debug.h"
 #include "linker_dlwarning.h"
+#include "linker_lazy_bind.h"
 #include "linker_main.h"
 #include "linker_namespaces.h"
 #include "linker_sleb128.h"
 #include "linker_phdr.h"
+#include "linker_phdr_snapshot.h"
+#include "linker_profile.h"
 #include "linker_relocate.h"
+#include "linker_relr.h"
+#include "linker_shared_relro.h"
 #include "linker_tls.h"
 #include "linker_translate_path.h"
 #include "linker_utils.h"
@@ -77,6 +86,7 @@
 #include "android-base/strings.h"
 #include "private/bionic_asm_note.h"
 #include "private/bionic_call_ifunc_resolver.h"
+#include "private/bionic_futex.h"
 #include "private/bionic_globals.h"
 #include "ziparchive/zip_archive.h"
 
@@ -271,6 +281,18 @@ static bool is_exempt_lib(android_namespace_t* ns, const char* name, const soinf
 
 static std::vector<std::string> g_ld_preload_names;
 
+// When set, the file ranges of a library's loadable segments are handed to the kernel for
+// readahead as soon as its headers have been read (see ElfReader::PrefetchSegments).
+static bool g_prefetch_dependencies = false;
+
+void set_prefetch_dependencies_mode(bool enable) {
+  g_prefetch_dependencies = enable;
+}
+
+bool get_prefetch_dependencies_mode() {
+  return g_prefetch_dependencies;
+}
+
 static void notify_gdb_of_load(soinfo* info) {
   if (info->is_linker() || info->is_main_executable()) {
     // gdb already knows about the linker and the main executable.
@@ -290,10 +312,6 @@ static void notify_gdb_of_load(soinfo* info) {
   notify_gdb_of_load(map);
 }
 
-static void notify_gdb_of_unload(soinfo* info) {
-  notify_gdb_of_unload(&(info->link_map_head));
-}
-
 LinkedListEntry<soinfo>* SoinfoListAllocator::alloc() {
   return g_soinfo_links_allocator.alloc();
 }
@@ -310,6 +328,37 @@ void NamespaceListAllocator::free(LinkedListEntry<android_namespace_t>* entry) {
   g_namespace_list_allocator.free(entry);
 }
 
+// The mapped range of every loaded library, sorted by start address, so that
+// find_containing_library() (and with it dladdr() and every caller_addr lookup)
+// is a binary search rather than a walk of the whole solist. Loaded libraries
+// never overlap. Only modified with g_dl_rwlock held for writing (or during
+// startup), so readers of g_dl_rwlock can search it.
+struct SoinfoAddressRange {
+  ElfW(Addr) start;
+  ElfW(Addr) end;
+  soinfo* si;
+};
+static std::vector<SoinfoAddressRange> g_soinfo_address_index;
+
+void soinfo_address_index_add(soinfo* si) {
+  if (si->size == 0) {
+    return;
+  }
+  auto it = std::upper_bound(g_soinfo_address_index.begin(), g_soinfo_address_index.end(), si->base,
+                             [](ElfW(Addr) addr, const SoinfoAddressRange& range) {
+                               return addr < range.start;
+                             });
+  g_soinfo_address_index.insert(it, {si->base, si->base + si->size, si});
+}
+
+static void soinfo_address_index_remove(soinfo* si) {
+  auto it = std::find_if(g_soinfo_address_index.begin(), g_soinfo_address_index.end(),
+                         [si](const SoinfoAddressRange& range) { return range.si == si; });
+  if (it != g_soinfo_address_index.end()) {
+    g_soinfo_address_index.erase(it);
+  }
+}
+
 soinfo* soinfo_alloc(android_namespace_t* ns, const char* name,
                      const struct stat* file_stat, off64_t file_offset,
                      uint32_t rtld_flags) {
@@ -323,6 +372,7 @@ soinfo* soinfo_alloc(android_namespace_t* ns, const char* name,
                                                        file_offset, rtld_flags);
 
   solist_add_soinfo(si);
+  phdr_snapshot_invalidate();
 
   si->generate_handle();
   ns->add_soinfo(si);
@@ -331,14 +381,26 @@ soinfo* soinfo_alloc(android_namespace_t* ns, const char* name,
   return si;
 }
 
+static void dlopen_cache_forget(soinfo* si);
+
 static void soinfo_free(soinfo* si) {
   if (si == nullptr) {
     return;
   }
 
+  soinfo_address_index_remove(si);
+  shared_relro_forget(si);
+  linker_profile_forget(si);
+  lazy_bind_forget(si);
+  dlopen_cache_forget(si);
+
+  // Lock-free dl_iterate_phdr() callers may still be looking at si's program headers, so the
+  // mapping is released through the snapshot code. A caller-provided range must be given back
+  // right away, because the caller may reuse it as soon as dlclose() returns.
+  phdr_snapshot_invalidate();
   if (si->base != 0 && si->size != 0) {
     if (!si->is_mapped_by_caller()) {
-      munmap(reinterpret_cast<void*>(si->base), si->size);
+      phdr_snapshot_unmap(reinterpret_cast<void*>(si->base), si->size);
     } else {
       // remap the region as PROT_NONE, MAP_ANONYMOUS | MAP_NORESERVE
       mmap(reinterpret_cast<void*>(si->base), si->size, PROT_NONE,
@@ -347,7 +409,7 @@ static void soinfo_free(soinfo* si) {
   }
 
   if (si->is_lp64_or_has_min_version(6) && si->get_gap_size()) {
-    munmap(reinterpret_cast<void*>(si->get_gap_start()), si->get_gap_size());
+    phdr_snapshot_unmap(reinterpret_cast<void*>(si->get_gap_start()), si->get_gap_size());
   }
 
   LD_DEBUG(any, "name %s: freeing soinfo @ %p", si->get_realpath(), si);
@@ -399,22 +461,28 @@ static bool realpath_fd(int fd, std::string* realpath) {
 
 // Returns the address of the current thread's copy of a TLS module. If the current thread doesn't
 // have a copy yet, allocate one on-demand if should_alloc is true, and return nullptr otherwise.
-static inline void* get_tls_block_for_this_thread(const soinfo_tls* si_tls, bool should_alloc) {
-  const TlsModule& tls_mod = get_tls_module(si_tls->module_id);
-  if (tls_mod.static_offset != SIZE_MAX) {
+static inline void* get_tls_block_for_this_thread(size_t module_id, size_t static_offset,
+                                                  size_t first_generation, bool should_alloc) {
+  if (static_offset != SIZE_MAX) {
     const StaticTlsLayout& layout = __libc_shared_globals()->static_tls_layout;
     char* static_tls = reinterpret_cast<char*>(__get_bionic_tcb()) - layout.offset_bionic_tcb();
-    return static_tls + tls_mod.static_offset;
+    return static_tls + static_offset;
   } else if (should_alloc) {
-    const TlsIndex ti { si_tls->module_id, static_cast<size_t>(0 - TLS_DTV_OFFSET) };
+    const TlsIndex ti { module_id, static_cast<size_t>(0 - TLS_DTV_OFFSET) };
     return TLS_GET_ADDR(&ti);
   } else {
     TlsDtv* dtv = __get_tcb_dtv(__get_bionic_tcb());
-    if (dtv->generation < tls_mod.first_generation) return nullptr;
-    return dtv->modules[__tls_module_id_to_idx(si_tls->module_id)];
+    if (dtv->generation < first_generation) return nullptr;
+    return dtv->modules[__tls_module_id_to_idx(module_id)];
   }
 }
 
+static inline void* get_tls_block_for_this_thread(const soinfo_tls* si_tls, bool should_alloc) {
+  const TlsModule& tls_mod = get_tls_module(si_tls->module_id);
+  return get_tls_block_for_this_thread(si_tls->module_id, tls_mod.static_offset,
+                                       tls_mod.first_generation, should_alloc);
+}
+
 #if defined(__arm__)
 
 // For a given PC, find the .so that it belongs to.
@@ -436,7 +504,98 @@ _Unwind_Ptr do_dl_unwind_find_exidx(_Unwind_Ptr pc, int* pcount) {
 
 // Here, we only have to provide a callback to iterate across all the
 // loaded libraries. gcc_eh does the rest.
+// Publishes what do_dl_iterate_phdr() reports for each library, for do_dl_iterate_phdr_lockfree().
+static void publish_phdr_snapshot() {
+  size_t count = 0;
+  size_t names_size = 0;
+  for (soinfo* si = solist_get_head(); si != nullptr; si = si->next) {
+    ++count;
+    if (si->link_map_head.l_name != nullptr) names_size += strlen(si->link_map_head.l_name) + 1;
+  }
+
+  PhdrSnapshot* snapshot = phdr_snapshot_alloc(count, names_size);
+  if (snapshot == nullptr) return;
+  snapshot->adds = g_module_load_counter;
+  snapshot->subs = g_module_unload_counter;
+  snapshot->tls_generation = atomic_load(&__libc_tls_generation_copy);
+
+  PhdrSnapshotEntry* entry = snapshot->entries;
+  char* name = snapshot->names;
+  for (soinfo* si = solist_get_head(); si != nullptr; si = si->next, ++entry) {
+    entry->addr = si->link_map_head.l_addr;
+    entry->name = nullptr;
+    if (const char* l_name = si->link_map_head.l_name) {
+      size_t length = strlen(l_name) + 1;
+      memcpy(name, l_name, length);
+      entry->name = name;
+      name += length;
+    }
+    entry->phdr = si->phdr;
+    entry->phnum = si->phnum;
+    if (soinfo_tls* tls_module = si->get_tls()) {
+      const TlsModule& tls_mod = get_tls_module(tls_module->module_id);
+      entry->tls_modid = tls_module->module_id;
+      entry->tls_static_offset = tls_mod.static_offset;
+      entry->tls_first_generation = tls_mod.first_generation;
+    } else {
+      entry->tls_modid = 0;
+    }
+  }
+  phdr_snapshot_publish(snapshot);
+}
+
+bool do_dl_iterate_phdr_lockfree(int (*cb)(dl_phdr_info* info, size_t size, void* data),
+                                 void* data, int* result) {
+  ScopedPhdrSnapshot holder;
+  const PhdrSnapshot* snapshot = holder.get();
+  if (snapshot == nullptr) {
+    return false;
+  }
+
+  // If this thread's DTV already reflects TLS modules loaded or unloaded since the snapshot was
+  // published, the snapshot's module IDs may name other libraries' blocks in it.
+  const TlsDtv* dtv = __get_tcb_dtv(__get_bionic_tcb());
+  if (dtv->generation > snapshot->tls_generation) {
+    return false;
+  }
+
+  int rv = 0;
+  for (size_t i = 0; i < snapshot->count; ++i) {
+    const PhdrSnapshotEntry& entry = snapshot->entries[i];
+    dl_phdr_info dl_info;
+    dl_info.dlpi_addr = entry.addr;
+    dl_info.dlpi_name = entry.name;
+    dl_info.dlpi_phdr = entry.phdr;
+    dl_info.dlpi_phnum = entry.phnum;
+    dl_info.dlpi_adds = snapshot->adds;
+    dl_info.dlpi_subs = snapshot->subs;
+    dl_info.dlpi_tls_modid = entry.tls_modid;
+    dl_info.dlpi_tls_data = nullptr;
+    // An earlier callback can have updated the DTV (by touching TLS), in which case its dynamic
+    // blocks can't be trusted any more.
+    if (entry.tls_modid != 0 &&
+        (entry.tls_static_offset != SIZE_MAX || dtv->generation <= snapshot->tls_generation)) {
+      dl_info.dlpi_tls_data = get_tls_block_for_this_thread(
+          entry.tls_modid, entry.tls_static_offset, entry.tls_first_generation,
+          /*should_alloc=*/false);
+    }
+
+    rv = cb(&dl_info, sizeof(dl_phdr_info), data);
+    if (rv != 0) {
+      break;
+    }
+  }
+  *result = rv;
+  return true;
+}
+
 int do_dl_iterate_phdr(int (*cb)(dl_phdr_info* info, size_t size, void* data), void* data) {
+  // Don't publish the state of a dlopen() or dlclose() that's still in progress on this thread
+  // (from a constructor, say); the next caller from outside will.
+  if (g_dl_mutex_depth == 1) {
+    publish_phdr_snapshot();
+  }
+
   int rv = 0;
   for (soinfo* si = solist_get_head(); si != nullptr; si = si->next) {
     dl_phdr_info dl_info;
@@ -623,7 +782,15 @@ class LoadTask {
 
   bool read(const char* realpath, off64_t file_size) {
     ElfReader& elf_reader = get_elf_reader();
-    return elf_reader.Read(realpath, fd_, file_offset_, file_size);
+    if (!elf_reader.Read(realpath, fd_, file_offset_, file_size)) {
+      return false;
+    }
+    // Start fetching the segments now, so that the I/O for the whole dependency graph overlaps
+    // instead of each library faulting its pages in only once it is mapped and relocated.
+    if (g_prefetch_dependencies) {
+      elf_reader.PrefetchSegments();
+    }
+    return true;
   }
 
   bool load(address_space_params* address_space) {
@@ -634,6 +801,7 @@ class LoadTask {
 
     si_->base = elf_reader.load_start();
     si_->size = elf_reader.load_size();
+    soinfo_address_index_add(si_);
     si_->set_mapped_by_caller(elf_reader.is_mapped_by_caller());
     si_->load_bias = elf_reader.load_bias();
     si_->phnum = elf_reader.phdr_count();
@@ -856,23 +1024,164 @@ static const ElfW(Sym)* dlsym_handle_lookup(soinfo* si,
   return dlsym_handle_lookup_impl(si->get_primary_namespace(), si, nullptr, found, symbol_name, vi);
 }
 
+// The maximum number of libraries dlsym_shared_handle_lookup() can visit; deeper trees fall back
+// to the allocating walk under g_dl_mutex.
+static constexpr size_t kMaxSharedWalkSize = 256;
+
+enum class SharedLookupResult { kFound, kNotFound, kGiveUp };
+
+// Mirrors dlsym_handle_lookup_impl() for callers that only hold g_dl_rwlock for reading. The
+// linker allocator is not thread-safe, so the breadth-first queue lives on the stack. Every
+// library is queued at most once, which visits libraries in the same order as
+// walk_dependencies_tree().
+static SharedLookupResult dlsym_shared_handle_lookup(android_namespace_t* ns,
+                                                     soinfo* root,
+                                                     soinfo* skip_until,
+                                                     soinfo** found,
+                                                     SymbolName& symbol_name,
+                                                     const version_info* vi,
+                                                     const ElfW(Sym)** sym) {
+  soinfo* queue[kMaxSharedWalkSize];
+  size_t head = 0;
+  size_t tail = 0;
+  bool overflow = false;
+  bool skip_lookup = skip_until != nullptr;
+
+  queue[tail++] = root;
+  while (head != tail) {
+    soinfo* si = queue[head++];
+
+    if (skip_lookup) {
+      skip_lookup = si != skip_until;
+    } else if (!ns->is_accessible(si)) {
+      continue;
+    } else if ((*sym = si->find_symbol_by_name(symbol_name, vi)) != nullptr) {
+      *found = si;
+      return SharedLookupResult::kFound;
+    }
+
+    si->get_children().for_each([&](soinfo* child) {
+      if (std::find(queue, queue + tail, child) != queue + tail) return;
+      if (tail == kMaxSharedWalkSize) {
+        overflow = true;
+        return;
+      }
+      queue[tail++] = child;
+    });
+    if (overflow) return SharedLookupResult::kGiveUp;
+  }
+
+  return SharedLookupResult::kNotFound;
+}
+
+// Mirrors dlsym_linear_lookup() for callers that only hold g_dl_rwlock for reading.
+static SharedLookupResult dlsym_shared_linear_lookup(android_namespace_t* ns,
+                                                     SymbolName& symbol_name,
+                                                     const version_info* vi,
+                                                     soinfo** found,
+                                                     soinfo* caller,
+                                                     void* handle,
+                                                     const ElfW(Sym)** sym) {
+  auto& soinfo_list = ns->soinfo_list();
+  auto start = soinfo_list.begin();
+
+  if (handle == RTLD_NEXT) {
+    if (caller == nullptr) return SharedLookupResult::kNotFound;
+    auto it = soinfo_list.find(caller);
+    if (it == soinfo_list.end()) return SharedLookupResult::kGiveUp;
+    start = ++it;
+  }
+
+  for (auto it = start, end = soinfo_list.end(); it != end; ++it) {
+    soinfo* si = *it;
+    if ((si->get_rtld_flags() & RTLD_GLOBAL) == 0 && si->get_target_sdk_version() >= 23) {
+      continue;
+    }
+    if ((*sym = si->find_symbol_by_name(symbol_name, vi)) != nullptr) {
+      *found = si;
+      return SharedLookupResult::kFound;
+    }
+  }
+
+  if (caller != nullptr) {
+    soinfo* local_group_root = caller->get_local_group_root();
+    return dlsym_shared_handle_lookup(local_group_root->get_primary_namespace(),
+                                      local_group_root,
+                                      (handle == RTLD_NEXT) ? caller : nullptr,
+                                      found,
+                                      symbol_name,
+                                      vi,
+                                      sym);
+  }
+
+  return SharedLookupResult::kNotFound;
+}
+
+bool lazy_bind_lookup(soinfo* si, const char* name, const version_info* vi, bool shared,
+                      soinfo** found, const ElfW(Sym)** sym) {
+  soinfo* local_group_root = si->get_local_group_root();
+  android_namespace_t* ns = local_group_root->get_primary_namespace();
+  *found = nullptr;
+  *sym = nullptr;
+
+  if (!shared) {
+    soinfo_list_t local_group;
+    walk_dependencies_tree(local_group_root, [&](soinfo* child) {
+      if (!ns->is_accessible(child)) return kWalkSkip;
+      local_group.push_back(child);
+      return kWalkContinue;
+    });
+    soinfo_list_t global_group = ns->get_global_group();
+    SymbolLookupList lookup_list(global_group, local_group);
+    lookup_list.set_dt_symbolic_lib(si->has_DT_SYMBOLIC ? si : nullptr);
+    *sym = soinfo_do_lookup(name, vi, found, lookup_list);
+    return true;
+  }
+
+  // The same order as SymbolLookupList: the DT_SYMBOLIC library, the global group, then the
+  // local group.
+  SymbolName symbol_name(name);
+  if (si->has_DT_SYMBOLIC && (*sym = si->find_symbol_by_name(symbol_name, vi)) != nullptr) {
+    *found = si;
+  }
+  for (soinfo* global : ns->soinfo_list()) {
+    if (*found != nullptr) break;
+    if ((global->get_dt_flags_1() & DF_1_GLOBAL) == 0) continue;
+    if ((*sym = global->find_symbol_by_name(symbol_name, vi)) != nullptr) {
+      *found = global;
+    }
+  }
+  if (*found == nullptr &&
+      dlsym_shared_handle_lookup(ns, local_group_root, nullptr, found, symbol_name, vi, sym) ==
+          SharedLookupResult::kGiveUp) {
+    return false;
+  }
+  // As in dlsym(), a library whose constructors are still running is only bound to with
+  // g_dl_mutex held.
+  return *found == nullptr || (*found)->constructors_finished();
+}
+
 soinfo* find_containing_library(const void* p) {
   // Addresses within a library may be tagged if they point to globals. Untag
   // them so that the bounds check succeeds.
   ElfW(Addr) address = reinterpret_cast<ElfW(Addr)>(untag_address(p));
-  for (soinfo* si = solist_get_head(); si != nullptr; si = si->next) {
-    if (address < si->base || address - si->base >= si->size) {
+  auto it = std::upper_bound(g_soinfo_address_index.begin(), g_soinfo_address_index.end(), address,
+                             [](ElfW(Addr) addr, const SoinfoAddressRange& range) {
+                               return addr < range.start;
+                             });
+  if (it == g_soinfo_address_index.begin() || address >= (--it)->end) {
+    return nullptr;
+  }
+
+  soinfo* si = it->si;
+  ElfW(Addr) vaddr = address - si->load_bias;
+  for (size_t i = 0; i != si->phnum; ++i) {
+    const ElfW(Phdr)* phdr = &si->phdr[i];
+    if (phdr->p_type != PT_LOAD) {
       continue;
     }
-    ElfW(Addr) vaddr = address - si->load_bias;
-    for (size_t i = 0; i != si->phnum; ++i) {
-      const ElfW(Phdr)* phdr = &si->phdr[i];
-      if (phdr->p_type != PT_LOAD) {
-        continue;
-      }
-      if (vaddr >= phdr->p_vaddr && vaddr < phdr->p_vaddr + phdr->p_memsz) {
-        return si;
-      }
+    if (vaddr >= phdr->p_vaddr && vaddr < phdr->p_vaddr + phdr->p_memsz) {
+      return si;
     }
   }
   return nullptr;
@@ -1668,6 +1977,14 @@ bool find_libraries(android_namespace_t* ns,
     shuffle(&load_list);
   }
 
+  // The WebView loader uses RELRO sharing in order to promote page sharing of the large RELRO
+  // segment, as it's full of C++ vtables. Because MTE globals, by default, applies random tags to
+  // each global variable, the RELRO segment is polluted and unique for each process. In order to
+  // allow sharing, but still provide some protection, we use deterministic global tagging schemes
+  // for DSOs that are loaded through android_dlopen_ext, such as those loaded by WebView.
+  bool dlext_use_relro =
+      extinfo && extinfo->flags & (ANDROID_DLEXT_WRITE_RELRO | ANDROID_DLEXT_USE_RELRO);
+
   // Set up address space parameters.
   address_space_params extinfo_params, default_params;
   size_t relro_fd_offset = 0;
@@ -1685,19 +2002,18 @@ bool find_libraries(android_namespace_t* ns,
   for (auto&& task : load_list) {
     address_space_params* address_space =
         (reserved_address_recursive || !task->is_dt_needed()) ? &extinfo_params : &default_params;
+    address_space_params shared_relro_params;
+    if (address_space->reserved_size == 0 && !dlext_use_relro &&
+        shared_relro_reserve(task->get_soinfo(), task->get_fd(), task->get_file_offset(),
+                             &shared_relro_params)) {
+      address_space = &shared_relro_params;
+    }
     if (!task->load(address_space)) {
       return false;
     }
+    shared_relro_loaded(task->get_soinfo());
   }
 
-  // The WebView loader uses RELRO sharing in order to promote page sharing of the large RELRO
-  // segment, as it's full of C++ vtables. Because MTE globals, by default, applies random tags to
-  // each global variable, the RELRO segment is polluted and unique for each process. In order to
-  // allow sharing, but still provide some protection, we use deterministic global tagging schemes
-  // for DSOs that are loaded through android_dlopen_ext, such as those loaded by WebView.
-  bool dlext_use_relro =
-      extinfo && extinfo->flags & (ANDROID_DLEXT_WRITE_RELRO | ANDROID_DLEXT_USE_RELRO);
-
   // Step 3: pre-link all DT_NEEDED libraries in breadth first order.
   bool any_memtag_stack = false;
   for (auto&& task : load_tasks) {
@@ -1776,7 +2092,9 @@ bool find_libraries(android_namespace_t* ns,
     }
   }
 
-  // Step 6: Link all local groups
+  // Step 6: Link all local groups. The CFI shadow is updated once for all of the new libraries,
+  // before any of their constructors run.
+  ScopedCFIShadowBatch cfi_shadow_batch;
   for (auto root : local_group_roots) {
     soinfo_list_t local_group;
     android_namespace_t* local_group_ns = root->get_primary_namespace();
@@ -1914,6 +2232,7 @@ static void soinfo_unload_impl(soinfo* root) {
                  child->get_realpath(), child);
 
         child->get_parents().remove(si);
+        invalidate_namespace_access_cache();
 
         if (local_unload_list.contains(child)) {
           continue;
@@ -1940,18 +2259,33 @@ static void soinfo_unload_impl(soinfo* root) {
            si);
   });
 
+  // Tear the group down as a whole: the CFI shadow, gdb's view of the link map and the TLS module
+  // table are each updated once, and the group's mappings are unmapped together (merging adjacent
+  // ones) once everything has been freed.
+  ScopedPhdrSnapshotBatch phdr_snapshot_batch;
+  {
+    ScopedCFIShadowBatch cfi_shadow_batch;
+    local_unload_list.for_each([](soinfo* si) { get_cfi_shadow()->BeforeUnload(si); });
+  }
+
+  std::vector<soinfo*> unloading;
+  std::vector<link_map*> link_maps;
+  local_unload_list.for_each([&](soinfo* si) {
+    unloading.push_back(si);
+    link_maps.push_back(&si->link_map_head);
+  });
+  notify_gdb_of_unloads(link_maps.data(), link_maps.size());
+  unregister_soinfo_tls(unloading);
+
   while ((si = local_unload_list.pop_front()) != nullptr) {
     LD_LOG(kLogDlopen,
            "... dlclose: unloading \"%s\"@%p ...",
            si->get_realpath(),
            si);
     ++g_module_unload_counter;
-    notify_gdb_of_unload(si);
-    unregister_soinfo_tls(si);
     if (__libc_shared_globals()->unload_hook) {
       __libc_shared_globals()->unload_hook(si->load_bias, si->phdr, si->phnum);
     }
-    get_cfi_shadow()->BeforeUnload(si);
     soinfo_free(si);
   }
 
@@ -2113,6 +2447,265 @@ static std::string android_dlextinfo_to_string(const android_dlextinfo* info) {
                                         info->library_namespace : nullptr);
 }
 
+// dlopen() calls that named a library by a bare name, keyed by the caller's namespace and the
+// name. A library is only recorded if it's the first one with that soname in the namespace's own
+// list, which is what find_library_internal() would settle on again: libraries are only ever
+// appended to that list, so an entry stays valid until its library is unloaded.
+struct DlopenCacheEntry {
+  android_namespace_t* ns;
+  std::string name;
+  soinfo* si;
+};
+
+static std::unordered_multimap<size_t, DlopenCacheEntry> g_dlopen_cache;
+
+// References taken by do_dlopen_loaded(), per local group root. Keeping them out of
+// soinfo::ref_count_ means the fast path doesn't have to make the soinfo pool writable (see
+// ProtectedDataGuard). do_dlclose_loaded() drops them before any counted in the soinfo, so a
+// library is never unloaded while it has any.
+static std::unordered_map<soinfo*, size_t> g_dlopen_fast_refs;
+
+static size_t dlopen_cache_hash(android_namespace_t* ns, std::string_view name) {
+  return std::hash<std::string_view>()(name) ^ std::hash<android_namespace_t*>()(ns);
+}
+
+static soinfo* dlopen_cache_find(android_namespace_t* ns, const char* name) {
+  auto [begin, end] = g_dlopen_cache.equal_range(dlopen_cache_hash(ns, name));
+  for (auto it = begin; it != end; ++it) {
+    if (it->second.ns == ns && it->second.name == name) return it->second.si;
+  }
+  return nullptr;
+}
+
+static void dlopen_cache_add(android_namespace_t* ns, const char* name, soinfo* si) {
+  soinfo* candidate;
+  if (name == nullptr || strchr(name, '/') != nullptr ||
+      !find_loaded_library_by_soname(ns, name, &candidate) || candidate != si ||
+      dlopen_cache_find(ns, name) != nullptr) {
+    return;
+  }
+  g_dlopen_cache.emplace(dlopen_cache_hash(ns, name), DlopenCacheEntry { ns, name, si });
+}
+
+static void dlopen_cache_forget(soinfo* si) {
+  for (auto it = g_dlopen_cache.begin(); it != g_dlopen_cache.end();) {
+    it = (it->second.si == si) ? g_dlopen_cache.erase(it) : std::next(it);
+  }
+  g_dlopen_fast_refs.erase(si);
+}
+
+void* do_dlopen_loaded(const char* name, int flags,
+                       const android_dlextinfo* extinfo,
+                       const void* caller_addr) {
+  if (name == nullptr ||
+      (flags & ~(RTLD_NOW|RTLD_LAZY|RTLD_LOCAL|RTLD_GLOBAL|RTLD_NODELETE|RTLD_NOLOAD)) != 0) {
+    return nullptr;
+  }
+
+  android_namespace_t* ns;
+  if (extinfo == nullptr) {
+    ns = get_caller_namespace(find_containing_library(caller_addr));
+  } else if (extinfo->flags == ANDROID_DLEXT_USE_NAMESPACE &&
+             extinfo->library_namespace != nullptr) {
+    ns = extinfo->library_namespace;
+  } else {
+    return nullptr;
+  }
+
+  soinfo* si = dlopen_cache_find(ns, name);
+  // A library whose constructors are still running on another thread needs do_dlopen() to wait.
+  if (si == nullptr || !si->constructors_finished()) return nullptr;
+
+  ++g_dlopen_fast_refs[si->get_local_group_root()];
+  void* handle = si->to_handle();
+  LD_LOG(kLogDlopen, "dlopen(name=\"%s\", flags=0x%x, ns=%s@%p) ... already loaded: handle=%p",
+         name, flags, ns->get_name(), ns, handle);
+  return handle;
+}
+
+static soinfo* soinfo_from_handle(void* handle);
+
+bool do_dlclose_loaded(void* handle) {
+  if (g_dlopen_fast_refs.empty() || (reinterpret_cast<uintptr_t>(handle) & 1) == 0) {
+    return false;
+  }
+  soinfo* si = soinfo_from_handle(handle);
+  if (si == nullptr) return false;
+
+  auto it = g_dlopen_fast_refs.find(si->get_local_group_root());
+  if (it == g_dlopen_fast_refs.end()) return false;
+  if (--it->second == 0) g_dlopen_fast_refs.erase(it);
+  LD_LOG(kLogDlopen, "dlclose(handle=%p, realpath=\"%s\"@%p) ... dropped a fast reference",
+         handle, si->get_realpath(), si);
+  return true;
+}
+
+// In a namespace with concurrent_constructors, a dlopen() that isn't called from a constructor
+// releases g_dl_mutex while it runs the constructors it is responsible for (its "constructor
+// phase"), so that dlopen() calls on other threads can load libraries and run their own
+// constructors in the meantime. A thread runs at most one phase at a time, and each library whose
+// constructors haven't finished is claimed by at most one phase. Every dlopen() waits for the
+// phases that claimed libraries it depends on before it returns, unless it can't wait without
+// risking a deadlock: when g_dl_mutex is held by an outer loader call on this thread, or when the
+// phase is itself waiting for this thread. That's the same as a dlopen() from a constructor of
+// one of its own dependencies.
+struct ConstructorPhase {
+  explicit ConstructorPhase(pid_t tid) : tid(tid) {}
+
+  const pid_t tid;
+  // The libraries this phase claimed, in the order their constructors are run. Another thread's
+  // dlopen() may still run one of them first, with g_dl_mutex held; the phase then skips it.
+  std::vector<soinfo*> libs;
+  // The phase this one is waiting for, if any.
+  ConstructorPhase* waiting_for = nullptr;
+  // The owning thread and any waiters each hold a reference.
+  size_t refs = 1;
+  // Set to 1 once every library in `libs` has run its constructors. Used as a futex.
+  std::atomic<int> done = 0;
+  ConstructorPhase* next = nullptr;
+};
+
+// Protected by g_dl_mutex.
+static ConstructorPhase* g_constructor_phases = nullptr;
+
+// Returns the phase the calling thread is running, if any. A dlopen() from one of its
+// constructors finds it here.
+static ConstructorPhase* current_constructor_phase() {
+  pid_t tid = gettid();
+  for (ConstructorPhase* phase = g_constructor_phases; phase != nullptr; phase = phase->next) {
+    if (phase->tid == tid) return phase;
+  }
+  return nullptr;
+}
+
+static ConstructorPhase* constructor_phase_for(const soinfo* si) {
+  for (ConstructorPhase* phase = g_constructor_phases; phase != nullptr; phase = phase->next) {
+    if (std::find(phase->libs.begin(), phase->libs.end(), si) != phase->libs.end()) return phase;
+  }
+  return nullptr;
+}
+
+static void constructor_phase_unref(ConstructorPhase* phase) {
+  if (--phase->refs == 0) delete phase;
+}
+
+// Releases g_dl_mutex, which the caller must hold exactly once.
+static void dl_mutex_release() {
+  g_dl_mutex_depth = 0;
+  pthread_mutex_unlock(&g_dl_mutex);
+}
+
+static void dl_mutex_reacquire() {
+  pthread_mutex_lock(&g_dl_mutex);
+  g_dl_mutex_depth = 1;
+}
+
+// Waits for `target` with g_dl_mutex released, on behalf of `phase` (the calling thread's phase,
+// or null). The caller must hold g_dl_mutex exactly once.
+static void constructor_phase_wait(ConstructorPhase* phase, ConstructorPhase* target) {
+  // If `target` is (transitively) waiting for this thread, waiting for it would never return.
+  pid_t tid = gettid();
+  for (const ConstructorPhase* p = target; p != nullptr; p = p->waiting_for) {
+    if (p->tid == tid) {
+      LD_DEBUG(calls, "[ Not waiting for constructors running on thread %d ]", target->tid);
+      return;
+    }
+  }
+
+  LD_DEBUG(calls, "[ Waiting for constructors running on thread %d ]", target->tid);
+  ++target->refs;
+  if (phase != nullptr) phase->waiting_for = target;
+  dl_mutex_release();
+  while (target->done.load(std::memory_order_acquire) == 0) {
+    __futex_wait(&target->done, 0, nullptr);
+  }
+  dl_mutex_reacquire();
+  if (phase != nullptr) phase->waiting_for = nullptr;
+  constructor_phase_unref(target);
+}
+
+// Waits for the phases of other threads that claimed any of `libs`, where that's possible.
+static void wait_for_other_constructor_phases(ConstructorPhase* phase,
+                                              const std::vector<soinfo*>& libs) {
+  if (g_dl_mutex_depth != 1) return;
+  for (soinfo* lib : libs) {
+    if (lib->constructors_finished()) continue;
+    // Looked up again for each library since waiting releases g_dl_mutex.
+    ConstructorPhase* target = constructor_phase_for(lib);
+    if (target != nullptr && target != phase) constructor_phase_wait(phase, target);
+  }
+}
+
+// Runs the constructors that dlopen() of `si` in `ns` is responsible for.
+static void call_dlopen_constructors(android_namespace_t* ns, soinfo* si) {
+  if (g_constructor_phases == nullptr && !ns->has_concurrent_constructors()) {
+    si->call_constructors();
+    return;
+  }
+
+  std::vector<soinfo*> unfinished;
+  std::vector<soinfo*> visited;
+  si->collect_unfinished_constructors(&unfinished, &visited);
+
+  ConstructorPhase* current = current_constructor_phase();
+  if (current != nullptr || !ns->has_concurrent_constructors() || g_dl_mutex_depth != 1) {
+    // Called from a constructor, or from a namespace that didn't opt in: run the constructors
+    // with g_dl_mutex held, as usual, once no other thread is running any of them. Libraries
+    // still claimed by this thread's own phase are run here, so a constructor that dlopen()s a
+    // dependency that hasn't been initialized yet gets it initialized.
+    wait_for_other_constructor_phases(current, unfinished);
+    si->call_constructors();
+    return;
+  }
+
+  ConstructorPhase* phase = new ConstructorPhase(gettid());
+  for (soinfo* lib : unfinished) {
+    if (!lib->constructors_called && constructor_phase_for(lib) == nullptr) {
+      phase->libs.push_back(lib);
+    }
+  }
+
+  // Everything run_constructors() needs is prepared here, while it's still safe to allocate.
+  std::vector<std::string> trace_messages;
+  std::vector<LinkerProfile*> profiles;
+  for (soinfo* lib : phase->libs) {
+    trace_messages.push_back(std::string("calling constructors: ") + lib->get_realpath());
+    profiles.push_back(linker_profile_for(lib));
+  }
+
+  phase->next = g_constructor_phases;
+  g_constructor_phases = phase;
+
+  wait_for_other_constructor_phases(phase, unfinished);
+
+  if (!phase->libs.empty()) {
+    LD_DEBUG(calls, "[ Running constructors of %zu libraries without the loader lock ]",
+             phase->libs.size());
+  }
+  for (size_t i = 0; i < phase->libs.size(); ++i) {
+    // Only mark each library as called right before running its constructors: a constructor
+    // that dlopen()s a later library of this phase runs that library's constructors itself.
+    if (!phase->libs[i]->claim_constructors()) continue;
+    dl_mutex_release();
+    phase->libs[i]->run_constructors(trace_messages[i].c_str(), profiles[i]);
+    dl_mutex_reacquire();
+  }
+
+  for (ConstructorPhase** p = &g_constructor_phases; *p != nullptr; p = &(*p)->next) {
+    if (*p == phase) {
+      *p = phase->next;
+      break;
+    }
+  }
+  phase->done.store(1, std::memory_order_release);
+  __futex_wake(&phase->done, INT_MAX);
+
+  for (size_t i = 0; i < phase->libs.size(); ++i) {
+    if (profiles[i] != nullptr) linker_profile_report(phase->libs[i]);
+  }
+  constructor_phase_unref(phase);
+}
+
 void* do_dlopen(const char* name, int flags,
                 const android_dlextinfo* extinfo,
                 const void* caller_addr) {
@@ -2239,11 +2832,18 @@ void* do_dlopen(const char* name, int flags,
     LD_LOG(kLogDlopen,
            "... dlopen calling constructors: realpath=\"%s\", soname=\"%s\", handle=%p",
            si->get_realpath(), si->get_soname(), handle);
-    si->call_constructors();
+    {
+      // Let dlsym() and dladdr() on other threads proceed while the constructors run.
+      ScopedDlWriteUnlock unlock;
+      call_dlopen_constructors(ns, si);
+    }
     failure_guard.Disable();
     LD_LOG(kLogDlopen,
            "... dlopen successful: realpath=\"%s\", soname=\"%s\", handle=%p",
            si->get_realpath(), si->get_soname(), handle);
+    if (extinfo == nullptr || extinfo->flags == ANDROID_DLEXT_USE_NAMESPACE) {
+      dlopen_cache_add(ns, name, si);
+    }
     return handle;
   }
 
@@ -2381,6 +2981,77 @@ bool do_dlsym(void* handle,
   return false;
 }
 
+bool do_dlsym_shared(void* handle,
+                     const char* sym_name,
+                     const char* sym_ver,
+                     const void* caller_addr,
+                     void** symbol) {
+  if (sym_name == nullptr) return false;
+#if !defined(__LP64__)
+  if (handle == nullptr) return false;
+#endif
+
+  ScopedTrace trace("dlsym");
+  soinfo* caller = find_containing_library(caller_addr);
+  android_namespace_t* ns = get_caller_namespace(caller);
+
+  version_info vi_instance;
+  version_info* vi = nullptr;
+  if (sym_ver != nullptr) {
+    vi_instance.name = sym_ver;
+    vi_instance.elf_hash = calculate_elf_hash(sym_ver);
+    vi = &vi_instance;
+  }
+
+  SymbolName symbol_name(sym_name);
+  soinfo* found = nullptr;
+  const ElfW(Sym)* sym = nullptr;
+  SharedLookupResult result;
+  if (handle == RTLD_DEFAULT || handle == RTLD_NEXT) {
+    result = dlsym_shared_linear_lookup(ns, symbol_name, vi, &found, caller, handle, &sym);
+  } else {
+    soinfo* si = soinfo_from_handle(handle);
+    if (si == nullptr) return false;
+    if (vi == nullptr && dlsym_cache_lookup(si, symbol_name, &found, &sym)) {
+      result = SharedLookupResult::kFound;
+    } else {
+      if (si == solist_get_somain()) {
+        result = dlsym_shared_linear_lookup(&g_default_namespace, symbol_name, vi, &found, nullptr,
+                                            RTLD_DEFAULT, &sym);
+      } else {
+        result = dlsym_shared_handle_lookup(si->get_primary_namespace(), si, nullptr, &found,
+                                            symbol_name, vi, &sym);
+      }
+      if (result == SharedLookupResult::kFound && vi == nullptr) {
+        dlsym_cache_insert(si, symbol_name, found, sym);
+      }
+    }
+  }
+  if (result != SharedLookupResult::kFound) return false;
+
+  // Symbols from libraries that are still running their constructors (on the thread that holds
+  // g_dl_mutex) must wait for dlopen() to finish. TLS symbols may allocate, and ifunc resolvers
+  // may re-enter the loader, so leave those to do_dlsym() too.
+  uint32_t bind = ELF_ST_BIND(sym->st_info);
+  uint32_t type = ELF_ST_TYPE(sym->st_info);
+  if ((bind != STB_GLOBAL && bind != STB_WEAK) || sym->st_shndx == 0 || type == STT_TLS ||
+      type == STT_GNU_IFUNC || !found->constructors_finished()) {
+    return false;
+  }
+
+  *symbol = reinterpret_cast<void*>(found->resolve_symbol_address(sym));
+  if (__libc_mte_enabled()) *symbol = get_tagged_address(*symbol);
+  return true;
+}
+
+static void log_allocator_stats(const char* name, const LinkerBlockAllocatorStats& stats) {
+  LD_DEBUG(statistics,
+           "%s allocator: %zu blocks of %zu bytes in use, %zu free, %zu pages mapped (%zu empty), "
+           "%zu pages released",
+           name, stats.allocated_blocks, stats.block_size, stats.free_blocks, stats.pages,
+           stats.empty_pages, stats.released_pages);
+}
+
 int do_dlclose(void* handle) {
   ScopedTrace trace("dlclose");
   ProtectedDataGuard guard;
@@ -2399,6 +3070,10 @@ int do_dlclose(void* handle) {
   LD_LOG(kLogDlopen,
          "dlclose(handle=%p) ... done",
          handle);
+  if (g_linker_debug_config.statistics) {
+    log_allocator_stats("soinfo", g_soinfo_allocator.stats());
+    log_allocator_stats("soinfo list", g_soinfo_links_allocator.stats());
+  }
   return 0;
 }
 
@@ -2794,13 +3469,8 @@ bool soinfo::lookup_version_info(const VersionTracker& version_tracker, ElfW(Wor
   return true;
 }
 
-static void apply_relr_reloc(ElfW(Addr) offset, ElfW(Addr) load_bias, bool has_memtag_globals) {
+static void apply_tagged_relr_reloc(ElfW(Addr) offset, ElfW(Addr) load_bias) {
   ElfW(Addr) destination = offset + load_bias;
-  if (!has_memtag_globals) {
-    *reinterpret_cast<ElfW(Addr)*>(destination) += load_bias;
-    return;
-  }
-
   ElfW(Addr)* tagged_destination =
       reinterpret_cast<ElfW(Addr)*>(get_tagged_address(reinterpret_cast<void*>(destination)));
   ElfW(Addr) tagged_value = reinterpret_cast<ElfW(Addr)>(
@@ -2813,6 +3483,12 @@ static void apply_relr_reloc(ElfW(Addr) offset, ElfW(Addr) load_bias, bool has_m
 //   https://groups.google.com/d/msg/generic-abi/bX460iggiKg/Pi9aSwwABgAJ
 bool relocate_relr(const ElfW(Relr) * begin, const ElfW(Relr) * end, ElfW(Addr) load_bias,
                    bool has_memtag_globals) {
+  if (!has_memtag_globals) {
+    apply_relr(begin, end, load_bias);
+    return true;
+  }
+
+  // With memtag globals, each relocated pointer is tagged, one relocation at a time.
   constexpr size_t wordsize = sizeof(ElfW(Addr));
 
   ElfW(Addr) base = 0;
@@ -2823,7 +3499,7 @@ bool relocate_relr(const ElfW(Relr) * begin, const ElfW(Relr) * end, ElfW(Addr)
     if ((entry&1) == 0) {
       // Even entry: encodes the offset for next relocation.
       offset = static_cast<ElfW(Addr)>(entry);
-      apply_relr_reloc(offset, load_bias, has_memtag_globals);
+      apply_tagged_relr_reloc(offset, load_bias);
       // Set base offset for subsequent bitmap entries.
       base = offset + wordsize;
       continue;
@@ -2834,7 +3510,7 @@ bool relocate_relr(const ElfW(Relr) * begin, const ElfW(Relr) * end, ElfW(Addr)
     while (entry != 0) {
       entry >>= 1;
       if ((entry&1) != 0) {
-        apply_relr_reloc(offset, load_bias, has_memtag_globals);
+        apply_tagged_relr_reloc(offset, load_bias);
       }
       offset += wordsize;
     }
@@ -2986,7 +3662,8 @@ bool soinfo::prelink_image(bool dlext_use_relro) {
         break;
 
       case DT_PLTGOT:
-        // Ignored (because RTLD_LAZY is not supported).
+        // Only used for lazy binding (see linker_lazy_bind.h).
+        plt_got_ = reinterpret_cast<ElfW(Addr)*>(load_bias + d->d_un.d_ptr);
         break;
 
       case DT_DEBUG:
@@ -3226,9 +3903,11 @@ bool soinfo::prelink_image(bool dlext_use_relro) {
 #if defined(__aarch64__)
       case DT_AARCH64_BTI_PLT:
       case DT_AARCH64_PAC_PLT:
-      case DT_AARCH64_VARIANT_PCS:
         // Ignored: AArch64 processor-specific dynamic array tags.
         break;
+      case DT_AARCH64_VARIANT_PCS:
+        has_variant_pcs_ = true;
+        break;
       case DT_AARCH64_MEMTAG_MODE:
         memtag_dynamic_entries_.has_memtag_mode = true;
         memtag_dynamic_entries_.memtag_mode = d->d_un.d_val;
@@ -3434,9 +4113,12 @@ bool soinfo::link_image(const SymbolLookupList& lookup_list, soinfo* local_group
       DL_ERR("failed mapping GNU RELRO section for \"%s\": %m", get_realpath());
       return false;
     }
+  } else if (!is_linker()) {
+    shared_relro_linked(this);
   }
 
   ++g_module_load_counter;
+  phdr_snapshot_invalidate();
   notify_gdb_of_load(this);
   set_image_linked();
   return true;
@@ -3667,6 +4349,9 @@ std::vector<android_namespace_t*> init_default_namespaces(const char* executable
   g_default_namespace.set_isolated(default_ns_config->isolated());
   g_default_namespace.set_default_library_paths(default_ns_config->search_paths());
   g_default_namespace.set_permitted_paths(default_ns_config->permitted_paths());
+  g_default_namespace.set_shared_relro_libs(default_ns_config->shared_relro_libs());
+  g_default_namespace.set_shared_relro_dir(default_ns_config->shared_relro_dir());
+  g_default_namespace.set_concurrent_constructors(default_ns_config->concurrent_constructors());
 
   namespaces[default_ns_config->name()] = &g_default_namespace;
   if (default_ns_config->visible()) {
@@ -3686,6 +4371,9 @@ std::vector<android_namespace_t*> init_default_namespaces(const char* executable
     ns->set_default_library_paths(ns_config->search_paths());
     ns->set_permitted_paths(ns_config->permitted_paths());
     ns->set_allowed_libs(ns_config->allowed_libs());
+    ns->set_shared_relro_libs(ns_config->shared_relro_libs());
+    ns->set_shared_relro_dir(ns_config->shared_relro_dir());
+    ns->set_concurrent_constructors(ns_config->concurrent_constructors());
 
     namespaces[ns_config->name()] = ns;
     if (ns_config->visible()) {
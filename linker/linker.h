@@ -74,6 +74,9 @@ class VersionTracker {
 soinfo* get_libdl_info(const soinfo& linker_si);
 
 soinfo* find_containing_library(const void* p);
+// Makes si's [base, base + size) visible to find_containing_library(). Called once si is mapped;
+// soinfo_free() removes it again.
+void soinfo_address_index_add(soinfo* si);
 
 int open_executable(const char* path, off64_t* file_offset, std::string* realpath);
 
@@ -88,17 +91,48 @@ int do_dlclose(void* handle);
 
 int do_dl_iterate_phdr(int (*cb)(dl_phdr_info* info, size_t size, void* data), void* data);
 
+// Iterates the snapshot published by the last do_dl_iterate_phdr() without taking g_dl_mutex.
+// Returns false, without calling cb, if the set of loaded libraries changed since.
+bool do_dl_iterate_phdr_lockfree(int (*cb)(dl_phdr_info* info, size_t size, void* data),
+                                 void* data, int* result);
+
 #if defined(__arm__)
 _Unwind_Ptr do_dl_unwind_find_exidx(_Unwind_Ptr pc, int* pcount);
 #endif
 
+// The fast path for dlopen() of a library that an earlier dlopen() already resolved the same bare
+// name to, from the same namespace: it only takes a reference. Returns nullptr (without reporting
+// an error) if the full do_dlopen() is needed. Needs g_dl_mutex but not g_dl_rwlock.
+void* do_dlopen_loaded(const char* name, int flags,
+                       const android_dlextinfo* extinfo,
+                       const void* caller_addr);
+
+// Drops a reference taken by do_dlopen_loaded() on the library of `handle`. Returns false if
+// there isn't one, in which case the full do_dlclose() is needed. Needs g_dl_mutex but not
+// g_dl_rwlock.
+bool do_dlclose_loaded(void* handle);
+
 bool do_dlsym(void* handle, const char* sym_name,
               const char* sym_ver,
               const void* caller_addr,
               void** symbol);
 
+// A do_dlsym() for callers holding g_dl_rwlock for reading instead of g_dl_mutex. It neither
+// allocates nor reports errors: false means "retry with do_dlsym()", not "undefined symbol".
+bool do_dlsym_shared(void* handle, const char* sym_name,
+                     const char* sym_ver,
+                     const void* caller_addr,
+                     void** symbol);
+
 int do_dladdr(const void* addr, Dl_info* info);
 
+// Finds the definition a lazily bound PLT slot of `si` should use (see linker_lazy_bind.h),
+// searching the scope find_libraries() linked `si` with. With `shared`, the caller only holds
+// g_dl_rwlock for reading and nothing is allocated; false then means the dependency tree was too
+// large to walk that way, so retry with g_dl_mutex held and `shared` false.
+bool lazy_bind_lookup(soinfo* si, const char* name, const version_info* vi, bool shared,
+                      soinfo** found, const ElfW(Sym)** sym);
+
 void set_application_target_sdk_version(int target);
 int get_application_target_sdk_version();
 
@@ -107,6 +141,9 @@ bool get_transparent_hugepages_supported();
 void set_16kb_appcompat_mode(bool enable_app_compat);
 bool get_16kb_appcompat_mode();
 
+void set_prefetch_dependencies_mode(bool enable);
+bool get_prefetch_dependencies_mode();
+
 enum {
   /* A regular namespace is the namespace with a custom search path that does
    * not impose any restrictions on the location of native libraries.
@@ -36,14 +36,21 @@
 #include <unistd.h>
 
 #include "linker_debug.h"
+#include "platform/bionic/page.h"
 
 static constexpr size_t kMaxPageSize = 65536;
 static constexpr size_t kAllocateSize = kMaxPageSize * 6;
 static_assert(kAllocateSize % kMaxPageSize == 0, "Invalid kAllocateSize.");
 
+static constexpr size_t kPageHeaderSize = __BIONIC_ALIGN(3 * sizeof(void*), 16);
+
 struct LinkerBlockAllocatorPage {
   LinkerBlockAllocatorPage* next;
-  uint8_t bytes[kAllocateSize - 16] __attribute__((aligned(16)));
+  // Each page keeps its own free list so that a page whose blocks have all been
+  // freed can be given back without touching the other pages.
+  void* free_block_list;
+  size_t allocated_blocks;
+  uint8_t bytes[kAllocateSize - kPageHeaderSize] __attribute__((aligned(16)));
 };
 
 struct FreeBlockInfo {
@@ -56,28 +63,33 @@ static_assert(kBlockSizeMin == sizeof(FreeBlockInfo));
 
 LinkerBlockAllocator::LinkerBlockAllocator(size_t block_size)
     : block_size_(__BIONIC_ALIGN(MAX(block_size, kBlockSizeMin), kBlockSizeAlign)),
+      blocks_per_page_(sizeof(LinkerBlockAllocatorPage::bytes) / block_size_),
       page_list_(nullptr),
-      free_block_list_(nullptr),
-      allocated_(0) {}
+      alloc_page_(nullptr),
+      allocated_(0),
+      pages_(0),
+      empty_pages_(0),
+      released_pages_(0) {}
 
 void* LinkerBlockAllocator::alloc() {
-  if (free_block_list_ == nullptr) {
-    create_new_page();
-  }
+  LinkerBlockAllocatorPage* page = find_free_page();
 
-  FreeBlockInfo* block_info = reinterpret_cast<FreeBlockInfo*>(free_block_list_);
+  FreeBlockInfo* block_info = reinterpret_cast<FreeBlockInfo*>(page->free_block_list);
   if (block_info->num_free_blocks > 1) {
     FreeBlockInfo* next_block_info = reinterpret_cast<FreeBlockInfo*>(
-      reinterpret_cast<char*>(free_block_list_) + block_size_);
+      reinterpret_cast<char*>(block_info) + block_size_);
     next_block_info->next_block = block_info->next_block;
     next_block_info->num_free_blocks = block_info->num_free_blocks - 1;
-    free_block_list_ = next_block_info;
+    page->free_block_list = next_block_info;
   } else {
-    free_block_list_ = block_info->next_block;
+    page->free_block_list = block_info->next_block;
   }
 
   memset(block_info, 0, block_size_);
 
+  if (page->allocated_blocks++ == 0) {
+    --empty_pages_;
+  }
   ++allocated_;
 
   return block_info;
@@ -98,12 +110,15 @@ void LinkerBlockAllocator::free(void* block) {
 
   FreeBlockInfo* block_info = reinterpret_cast<FreeBlockInfo*>(block);
 
-  block_info->next_block = free_block_list_;
+  block_info->next_block = page->free_block_list;
   block_info->num_free_blocks = 1;
 
-  free_block_list_ = block_info;
+  page->free_block_list = block_info;
 
   --allocated_;
+  if (--page->allocated_blocks == 0) {
+    page_emptied(page);
+  }
 }
 
 void LinkerBlockAllocator::protect_all(int prot) {
@@ -114,7 +129,31 @@ void LinkerBlockAllocator::protect_all(int prot) {
   }
 }
 
-void LinkerBlockAllocator::create_new_page() {
+// Returns a page with at least one free block. Pages that already have blocks
+// in use are preferred over an empty one, so that the empty page can stay
+// empty (and released) for as long as possible.
+LinkerBlockAllocatorPage* LinkerBlockAllocator::find_free_page() {
+  if (alloc_page_ != nullptr && alloc_page_->free_block_list != nullptr &&
+      alloc_page_->allocated_blocks != 0) {
+    return alloc_page_;
+  }
+
+  LinkerBlockAllocatorPage* empty_page = nullptr;
+  for (LinkerBlockAllocatorPage* page = page_list_; page != nullptr; page = page->next) {
+    if (page->free_block_list == nullptr) continue;
+    if (page->allocated_blocks == 0) {
+      empty_page = page;
+      continue;
+    }
+    alloc_page_ = page;
+    return page;
+  }
+
+  alloc_page_ = (empty_page != nullptr) ? empty_page : create_new_page();
+  return alloc_page_;
+}
+
+LinkerBlockAllocatorPage* LinkerBlockAllocator::create_new_page() {
   static_assert(sizeof(LinkerBlockAllocatorPage) == kAllocateSize,
                 "Invalid sizeof(LinkerBlockAllocatorPage)");
 
@@ -125,13 +164,58 @@ void LinkerBlockAllocator::create_new_page() {
   prctl(PR_SET_VMA, PR_SET_VMA_ANON_NAME, page, kAllocateSize, "linker_alloc");
 
   FreeBlockInfo* first_block = reinterpret_cast<FreeBlockInfo*>(page->bytes);
-  first_block->next_block = free_block_list_;
-  first_block->num_free_blocks = sizeof(page->bytes) / block_size_;
+  first_block->next_block = nullptr;
+  first_block->num_free_blocks = blocks_per_page_;
 
-  free_block_list_ = first_block;
+  page->free_block_list = first_block;
+  page->allocated_blocks = 0;
 
   page->next = page_list_;
   page_list_ = page;
+  ++pages_;
+  ++empty_pages_;
+  return page;
+}
+
+// Called when the last block in use on a page is freed. One empty page is kept
+// around so that allocating and freeing around a page boundary (dlopen() and
+// dlclose() of the same library, say) doesn't map and unmap a page every time;
+// any other empty page is unmapped.
+void LinkerBlockAllocator::page_emptied(LinkerBlockAllocatorPage* page) {
+  if (empty_pages_ == 0) {
+    ++empty_pages_;
+    reset_page(page);
+    return;
+  }
+
+  LinkerBlockAllocatorPage** link = &page_list_;
+  while (*link != page) {
+    link = &(*link)->next;
+  }
+  *link = page->next;
+  if (alloc_page_ == page) {
+    alloc_page_ = nullptr;
+  }
+  munmap(page, kAllocateSize);
+  --pages_;
+  ++released_pages_;
+}
+
+// Turns an empty page back into a single run of free blocks, and gives the
+// memory past the page's first block back to the system. Blocks are zeroed on
+// allocation, so it doesn't matter that the released memory reads back as
+// zeroes.
+void LinkerBlockAllocator::reset_page(LinkerBlockAllocatorPage* page) {
+  FreeBlockInfo* first_block = reinterpret_cast<FreeBlockInfo*>(page->bytes);
+  first_block->next_block = nullptr;
+  first_block->num_free_blocks = blocks_per_page_;
+  page->free_block_list = first_block;
+
+  uintptr_t release_start = page_end(reinterpret_cast<uintptr_t>(first_block + 1));
+  uintptr_t release_end = reinterpret_cast<uintptr_t>(page) + kAllocateSize;
+  if (release_start < release_end) {
+    madvise(reinterpret_cast<void*>(release_start), release_end - release_start, MADV_DONTNEED);
+  }
 }
 
 LinkerBlockAllocatorPage* LinkerBlockAllocator::find_page(void* block) {
@@ -140,7 +224,7 @@ LinkerBlockAllocatorPage* LinkerBlockAllocator::find_page(void* block) {
   LinkerBlockAllocatorPage* page = page_list_;
   while (page != nullptr) {
     const uint8_t* page_ptr = reinterpret_cast<const uint8_t*>(page);
-    if (block >= (page_ptr + sizeof(page->next)) && block < (page_ptr + kAllocateSize)) {
+    if (block >= page->bytes && block < (page_ptr + kAllocateSize)) {
       return page;
     }
 
@@ -161,6 +245,20 @@ void LinkerBlockAllocator::purge() {
     munmap(page, kAllocateSize);
     page = next;
   }
+  released_pages_ += pages_;
   page_list_ = nullptr;
-  free_block_list_ = nullptr;
+  alloc_page_ = nullptr;
+  pages_ = 0;
+  empty_pages_ = 0;
+}
+
+LinkerBlockAllocatorStats LinkerBlockAllocator::stats() const {
+  return LinkerBlockAllocatorStats{
+      .block_size = block_size_,
+      .allocated_blocks = allocated_,
+      .free_blocks = pages_ * blocks_per_page_ - allocated_,
+      .pages = pages_,
+      .empty_pages = empty_pages_,
+      .released_pages = released_pages_,
+  };
 }
@@ -38,6 +38,19 @@ static constexpr size_t kBlockSizeMin = sizeof(void*) * 2;
 
 struct LinkerBlockAllocatorPage;
 
+struct LinkerBlockAllocatorStats {
+  size_t block_size;
+  // Blocks currently handed out.
+  size_t allocated_blocks;
+  // Blocks available in the pages currently mapped.
+  size_t free_blocks;
+  // Pages currently mapped, and how many of those have no blocks in use.
+  size_t pages;
+  size_t empty_pages;
+  // Pages given back to the system since the allocator was created.
+  size_t released_pages;
+};
+
 /*
  * This class is a non-template version of the LinkerTypeAllocator
  * It keeps code inside .cpp file by keeping the interface
@@ -56,14 +69,24 @@ class LinkerBlockAllocator {
   // Purge all pages if all previously allocated blocks have been freed.
   void purge();
 
+  LinkerBlockAllocatorStats stats() const;
+
  private:
-  void create_new_page();
+  LinkerBlockAllocatorPage* find_free_page();
+  LinkerBlockAllocatorPage* create_new_page();
   LinkerBlockAllocatorPage* find_page(void* block);
+  void page_emptied(LinkerBlockAllocatorPage* page);
+  void reset_page(LinkerBlockAllocatorPage* page);
 
   size_t block_size_;
+  size_t blocks_per_page_;
   LinkerBlockAllocatorPage* page_list_;
-  void* free_block_list_;
+  // The page the last block was allocated from.
+  LinkerBlockAllocatorPage* alloc_page_;
   size_t allocated_;
+  size_t pages_;
+  size_t empty_pages_;
+  size_t released_pages_;
 
   DISALLOW_COPY_AND_ASSIGN(LinkerBlockAllocator);
 };
@@ -80,7 +103,9 @@ class LinkerBlockAllocator {
  *    513 this allocator will use 516 (520 for lp64) bytes of data where
  *    generalized implementation is going to use 1024 sized blocks.
  *
- * 2. This allocator does not munmap allocated memory, where BionicAllocator does.
+ * 2. Like BionicAllocator, this allocator gives back pages whose blocks have all
+ *    been freed, but it keeps one such page mapped (with its memory released
+ *    by madvise) so that an alloc/free cycle doesn't map and unmap each time.
  *
  * 3. This allocator provides mprotect services to the user, where BionicAllocator
  *    always treats its memory as READ|WRITE.
@@ -92,6 +117,7 @@ class LinkerTypeAllocator {
   T* alloc() { return reinterpret_cast<T*>(block_allocator_.alloc()); }
   void free(T* t) { block_allocator_.free(t); }
   void protect_all(int prot) { block_allocator_.protect_all(prot); }
+  LinkerBlockAllocatorStats stats() const { return block_allocator_.stats(); }
  private:
   LinkerBlockAllocator block_allocator_;
   DISALLOW_COPY_AND_ASSIGN(LinkerTypeAllocator);
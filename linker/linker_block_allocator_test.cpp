@@ -26,6 +26,7 @@
  * SUCH DAMAGE.
  */
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
@@ -33,6 +34,8 @@
 
 #include <gtest/gtest.h>
 
+#include <vector>
+
 #include "linker_block_allocator.h"
 
 #include <unistd.h>
@@ -144,3 +147,84 @@ TEST(linker_allocator, test_protect) {
   testing::FLAGS_gtest_death_test_style = "threadsafe";
   ASSERT_EXIT(protect_all(), testing::KilledBySignal(SIGSEGV), "trying to access protected page");
 }
+
+static size_t resident_bytes() {
+  FILE* fp = fopen("/proc/self/statm", "re");
+  if (fp == nullptr) return 0;
+  size_t size, resident;
+  if (fscanf(fp, "%zu %zu", &size, &resident) != 2) resident = 0;
+  fclose(fp);
+  return resident * kPageSize;
+}
+
+TEST(linker_allocator, test_releases_empty_pages) {
+  LinkerTypeAllocator<test_struct_larger> allocator;
+
+  // Fill several pages, touching every block.
+  std::vector<test_struct_larger*> blocks;
+  while (allocator.stats().pages < 8) {
+    test_struct_larger* p = allocator.alloc();
+    ASSERT_TRUE(p != nullptr);
+    memset(p->str, 0xff, sizeof(p->str));
+    blocks.push_back(p);
+  }
+  LinkerBlockAllocatorStats stats = allocator.stats();
+  ASSERT_EQ(blocks.size(), stats.allocated_blocks);
+  ASSERT_EQ(0U, stats.empty_pages);
+
+  // Free everything but the last block: every page but one goes away, and the
+  // one left is still in use.
+  test_struct_larger* last = blocks.back();
+  blocks.pop_back();
+  for (test_struct_larger* p : blocks) allocator.free(p);
+  stats = allocator.stats();
+  ASSERT_EQ(1U, stats.allocated_blocks);
+  ASSERT_EQ(2U, stats.pages);
+  ASSERT_EQ(1U, stats.empty_pages);
+  ASSERT_EQ(6U, stats.released_pages);
+
+  // Blocks handed out again come back zeroed, including from the released
+  // memory of the empty page.
+  blocks.clear();
+  while (allocator.stats().pages < 3) {
+    test_struct_larger* p = allocator.alloc();
+    for (char c : p->str) ASSERT_EQ(0, c);
+    blocks.push_back(p);
+  }
+  for (test_struct_larger* p : blocks) allocator.free(p);
+  allocator.free(last);
+  stats = allocator.stats();
+  ASSERT_EQ(0U, stats.allocated_blocks);
+  ASSERT_EQ(1U, stats.pages);
+  ASSERT_EQ(1U, stats.empty_pages);
+}
+
+// Repeatedly filling and emptying the allocator, as a process that keeps
+// calling dlopen() and dlclose() does, mustn't make its resident size grow.
+TEST(linker_allocator, test_rss_over_time) {
+  LinkerTypeAllocator<test_struct_larger> allocator;
+  constexpr size_t kPages = 16;
+
+  size_t baseline = 0;
+  for (size_t round = 0; round < 8; ++round) {
+    std::vector<test_struct_larger*> blocks;
+    while (allocator.stats().pages < kPages) {
+      test_struct_larger* p = allocator.alloc();
+      memset(p->str, 0xff, sizeof(p->str));
+      blocks.push_back(p);
+    }
+    size_t full = resident_bytes();
+
+    for (test_struct_larger* p : blocks) allocator.free(p);
+    size_t empty = resident_bytes();
+    ASSERT_EQ(1U, allocator.stats().pages);
+
+    // The 16 pages are 6MiB when touched; at least most of that must be gone.
+    ASSERT_GT(full, empty + 4 * 1024 * 1024) << "round " << round;
+    if (round == 0) {
+      baseline = empty;
+    } else {
+      ASSERT_LE(empty, baseline + 1024 * 1024) << "round " << round;
+    }
+  }
+}
@@ -38,35 +38,27 @@
 #include <cstdint>
 
 // Update shadow without making it writable by preparing the data on the side and mremap-ing it in
-// place.
+// place. The range must be page aligned; its current contents are copied to the side first.
 class ShadowWrite {
-  char* shadow_start;
-  char* shadow_end;
   char* aligned_start;
   char* aligned_end;
   char* tmp_start;
 
  public:
-  ShadowWrite(uint16_t* s, uint16_t* e) {
-    shadow_start = reinterpret_cast<char*>(s);
-    shadow_end = reinterpret_cast<char*>(e);
-    aligned_start = reinterpret_cast<char*>(page_start(reinterpret_cast<uintptr_t>(shadow_start)));
-    aligned_end = reinterpret_cast<char*>(page_end(reinterpret_cast<uintptr_t>(shadow_end)));
+  ShadowWrite(uintptr_t start, uintptr_t end) {
+    aligned_start = reinterpret_cast<char*>(start);
+    aligned_end = reinterpret_cast<char*>(end);
     tmp_start =
         reinterpret_cast<char*>(mmap(nullptr, aligned_end - aligned_start, PROT_READ | PROT_WRITE,
                                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
     CHECK(tmp_start != MAP_FAILED);
     mprotect(aligned_start, aligned_end - aligned_start, PROT_READ);
-    memcpy(tmp_start, aligned_start, shadow_start - aligned_start);
-    memcpy(tmp_start + (shadow_end - aligned_start), shadow_end, aligned_end - shadow_end);
+    memcpy(tmp_start, aligned_start, aligned_end - aligned_start);
   }
 
-  uint16_t* begin() {
-    return reinterpret_cast<uint16_t*>(tmp_start + (shadow_start - aligned_start));
-  }
-
-  uint16_t* end() {
-    return reinterpret_cast<uint16_t*>(tmp_start + (shadow_end - aligned_start));
+  // Returns the location on the side that stands in for the shadow element p.
+  uint16_t* at(uint16_t* p) {
+    return reinterpret_cast<uint16_t*>(tmp_start + (reinterpret_cast<char*>(p) - aligned_start));
   }
 
   ~ShadowWrite() {
@@ -82,12 +74,73 @@ void CFIShadowWriter::FixupVmaName() {
   prctl(PR_SET_VMA, PR_SET_VMA_ANON_NAME, *shadow_start, kShadowSize, "cfi shadow");
 }
 
-void CFIShadowWriter::AddConstant(uintptr_t begin, uintptr_t end, uint16_t v) {
-  uint16_t* shadow_begin = MemToShadow(begin);
-  uint16_t* shadow_end = MemToShadow(end - 1) + 1;
+void CFIShadowWriter::QueueWrite(const PendingWrite& write) {
+  pending_writes.push_back(write);
+  if (batch_depth == 0) {
+    Flush();
+  }
+}
+
+void CFIShadowWriter::Flush() {
+  if (pending_writes.empty()) {
+    return;
+  }
+
+  // Libraries are usually mapped next to each other, and a page of shadow covers far more address
+  // space than a typical library, so most writes land on the same few pages. Merge the page
+  // ranges and rewrite each merged range once.
+  std::vector<std::pair<uintptr_t, uintptr_t>> ranges;
+  for (const PendingWrite& w : pending_writes) {
+    ranges.emplace_back(page_start(reinterpret_cast<uintptr_t>(MemToShadow(w.begin))),
+                        page_end(reinterpret_cast<uintptr_t>(MemToShadow(w.end - 1) + 1)));
+  }
+  std::sort(ranges.begin(), ranges.end());
+  size_t merged = 0;
+  for (size_t i = 1; i < ranges.size(); ++i) {
+    if (ranges[i].first <= ranges[merged].second) {
+      ranges[merged].second = std::max(ranges[merged].second, ranges[i].second);
+    } else {
+      ranges[++merged] = ranges[i];
+    }
+  }
+  ranges.resize(merged + 1);
+
+  for (const auto& [start, end] : ranges) {
+    ShadowWrite sw(start, end);
+    // Apply the writes in the order they were queued, since they may overlap.
+    for (const PendingWrite& w : pending_writes) {
+      uintptr_t shadow_begin = reinterpret_cast<uintptr_t>(MemToShadow(w.begin));
+      if (shadow_begin < start || shadow_begin >= end) {
+        continue;
+      }
+      uint16_t* begin = sw.at(MemToShadow(w.begin));
+      uint16_t* end = sw.at(MemToShadow(w.end - 1) + 1);
+      if (w.cfi_check == 0) {
+        std::fill(begin, end, w.value);
+      } else {
+        // Each write used to get a blank range on the side, so FillCfiCheck() never saw what was
+        // in the shadow before. Keep it that way rather than start falling back to unchecked
+        // whenever a library shares a granule with one loaded earlier.
+        std::fill(begin, end, kInvalidShadow);
+        FillCfiCheck(begin, end, w.begin, w.cfi_check);
+      }
+    }
+    ++remap_count;
+    remapped_pages += (end - start) / page_size();
+  }
+  write_count += pending_writes.size();
+
+  LD_DEBUG(cfi, "[ CFI shadow: %zu writes in %zu page ranges ]", pending_writes.size(),
+           ranges.size());
+  // Before batching, every write was a remap of its own.
+  LD_DEBUG(statistics, "CFI shadow: %zu writes applied with %zu remaps of %zu pages", write_count,
+           remap_count, remapped_pages);
+  pending_writes.clear();
+  FixupVmaName();
+}
 
-  ShadowWrite sw(shadow_begin, shadow_end);
-  std::fill(sw.begin(), sw.end(), v);
+void CFIShadowWriter::AddConstant(uintptr_t begin, uintptr_t end, uint16_t v) {
+  QueueWrite({.begin = begin, .end = end, .cfi_check = 0, .value = v});
 }
 
 void CFIShadowWriter::AddUnchecked(uintptr_t begin, uintptr_t end) {
@@ -105,10 +158,11 @@ void CFIShadowWriter::Add(uintptr_t begin, uintptr_t end, uintptr_t cfi_check) {
   // in the shadow, and must make sure at codegen to place all valid call
   // targets above cfi_check.
   begin = std::max(begin, cfi_check) & ~(kShadowAlign - 1);
-  uint16_t* shadow_begin = MemToShadow(begin);
-  uint16_t* shadow_end = MemToShadow(end - 1) + 1;
+  QueueWrite({.begin = begin, .end = end, .cfi_check = cfi_check, .value = 0});
+}
 
-  ShadowWrite sw(shadow_begin, shadow_end);
+void CFIShadowWriter::FillCfiCheck(uint16_t* shadow_begin, uint16_t* shadow_end, uintptr_t begin,
+                                   uintptr_t cfi_check) {
   uint16_t sv_begin = ((begin + kShadowAlign - cfi_check) >> kCfiCheckGranularity) + kRegularShadowMin;
 
   // With each step of the loop below, __cfi_check address computation base is increased by
@@ -117,16 +171,16 @@ void CFIShadowWriter::Add(uintptr_t begin, uintptr_t end, uintptr_t cfi_check) {
   // 2**CfiCheckGranularity.
   uint16_t sv_step = 1 << (kShadowGranularity - kCfiCheckGranularity);
   uint16_t sv = sv_begin;
-  for (uint16_t& s : sw) {
+  for (uint16_t* s = shadow_begin; s != shadow_end; ++s) {
     if (sv < sv_begin) {
       // If shadow value wraps around, also fall back to unchecked. This means the binary is too
       // large. FIXME: consider using a (slow) resolution function instead.
-      s = kUncheckedShadow;
+      *s = kUncheckedShadow;
       continue;
     }
     // If there is something there already, fall back to unchecked. This may happen in rare cases
     // with MAP_FIXED libraries. FIXME: consider using a (slow) resolution function instead.
-    s = (s == kInvalidShadow) ? sv : kUncheckedShadow;
+    *s = (*s == kInvalidShadow) ? sv : kUncheckedShadow;
     sv += sv_step;
   }
 }
@@ -235,11 +289,11 @@ bool CFIShadowWriter::MaybeInit(soinfo* new_si, soinfo* solist) {
   // Init shadow and add all currently loaded libraries (not just the new ones).
   if (!NotifyLibDl(solist, MapShadow()))
     return false;
+  ScopedCFIShadowBatch batch;
   for (soinfo* si = solist; si != nullptr; si = si->next) {
     if (!AddLibrary(si))
       return false;
   }
-  FixupVmaName();
   return true;
 }
 
@@ -254,10 +308,7 @@ bool CFIShadowWriter::AfterLoad(soinfo* si, soinfo* solist) {
   }
 
   // Add the new library to the CFI shadow.
-  if (!AddLibrary(si))
-    return false;
-  FixupVmaName();
-  return true;
+  return AddLibrary(si);
 }
 
 void CFIShadowWriter::BeforeUnload(soinfo* si) {
@@ -266,7 +317,6 @@ void CFIShadowWriter::BeforeUnload(soinfo* si) {
   LD_DEBUG(cfi, "[ CFI remove 0x%zx + 0x%zx: %s ]", static_cast<uintptr_t>(si->base),
            static_cast<uintptr_t>(si->size), si->get_soname());
   AddInvalid(si->base, si->base + si->size);
-  FixupVmaName();
 }
 
 bool CFIShadowWriter::InitialLinkDone(soinfo* solist) {
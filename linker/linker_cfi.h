@@ -32,6 +32,7 @@
 #include "linker_debug.h"
 
 #include <algorithm>
+#include <vector>
 
 #include "private/CFIShadow.h"
 
@@ -42,12 +43,31 @@
 // Shadow is mapped and initialized lazily as soon as the first CFI-enabled DSO is loaded.
 // It is updated after any library is loaded (but before any constructors are ran), and
 // before any library is unloaded.
+//
+// Writes are queued and applied by Flush(), which rewrites each affected run of shadow pages once.
+// Between BeginBatch() and EndBatch() the queue is only flushed at the end, so that loading or
+// unloading dozens of libraries (whose shadow usually shares a page or two) costs one remap.
 class CFIShadowWriter : private CFIShadow {
+  // A queued update of the shadow for [begin, end): the given __cfi_check, or the constant value
+  // if cfi_check is 0.
+  struct PendingWrite {
+    uintptr_t begin;
+    uintptr_t end;
+    uintptr_t cfi_check;
+    uint16_t value;
+  };
+
   // Returns pointer to the shadow element for an address.
   uint16_t* MemToShadow(uintptr_t x) {
     return reinterpret_cast<uint16_t*>(*shadow_start + MemToShadowOffset(x));
   }
 
+  // Queue a write, and apply it right away unless a batch is open.
+  void QueueWrite(const PendingWrite& write);
+
+  // Apply all queued writes.
+  void Flush();
+
   // Update shadow for the address range to the given constant value.
   void AddConstant(uintptr_t begin, uintptr_t end, uint16_t v);
 
@@ -60,6 +80,11 @@ class CFIShadowWriter : private CFIShadow {
   // Update shadow for the address range to the given __cfi_check value.
   void Add(uintptr_t begin, uintptr_t end, uintptr_t cfi_check);
 
+  // Fill [shadow_begin, shadow_end), the shadow for addresses starting at begin, with values
+  // pointing at cfi_check.
+  static void FillCfiCheck(uint16_t* shadow_begin, uint16_t* shadow_end, uintptr_t begin,
+                           uintptr_t cfi_check);
+
   // Add a DSO to CFI shadow.
   bool AddLibrary(soinfo* si);
 
@@ -83,6 +108,14 @@ class CFIShadowWriter : private CFIShadow {
 
   bool initial_link_done;
 
+  std::vector<PendingWrite> pending_writes;
+  size_t batch_depth;
+
+  // Totals for LD_DEBUG=statistics.
+  size_t write_count;
+  size_t remap_count;
+  size_t remapped_pages;
+
  public:
   // Update shadow after loading a DSO.
   // This function will initialize the shadow if it sees a CFI-enabled DSO for the first time.
@@ -97,8 +130,24 @@ class CFIShadowWriter : private CFIShadow {
   // This is called as soon as the initial set of libraries is linked.
   bool InitialLinkDone(soinfo *solist);
 
+  // Defer shadow writes until the matching EndBatch(). Batches nest.
+  void BeginBatch() { ++batch_depth; }
+  void EndBatch() {
+    if (--batch_depth == 0) Flush();
+  }
+
   // Handle failure to locate __cfi_check for a target address.
   static void CfiFail(uint64_t CallSiteTypeId, void* Ptr, void* DiagData, void *caller_pc);
 };
 
 CFIShadowWriter* get_cfi_shadow();
+
+// Batches CFI shadow updates for the lifetime of the object; see CFIShadowWriter::BeginBatch().
+class ScopedCFIShadowBatch {
+ public:
+  ScopedCFIShadowBatch() { get_cfi_shadow()->BeginBatch(); }
+  ~ScopedCFIShadowBatch() { get_cfi_shadow()->EndBatch(); }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ScopedCFIShadowBatch);
+};
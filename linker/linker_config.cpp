@@ -39,8 +39,11 @@
 
 #include <async_safe/log.h>
 
+#include <fcntl.h>
 #include <limits.h>
 #include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include <string>
@@ -176,33 +179,21 @@ static std::string create_error_msg(const char* file,
   return std::string(buf);
 }
 
-static bool parse_config_file(const char* ld_config_file_path,
-                              const char* binary_realpath,
-                              std::unordered_map<std::string, PropertyValue>* properties,
-                              std::string* error_msg) {
-  std::string content;
-  if (!android::base::ReadFileToString(ld_config_file_path, &content)) {
-    if (errno != ENOENT) {
-      *error_msg = std::string("error reading file \"") +
-                   ld_config_file_path + "\": " + strerror(errno);
-    }
-    return false;
-  }
-
-  ConfigParser cp(std::move(content));
-
-  std::string section_name;
-
+// Walks the dir.<section> properties at the top of the config file, calling
+// on_dir(resolved_path, section_name) for each directory that exists until it
+// returns true. Returns false if the first section was reached first.
+template <typename F>
+static bool parse_config_dirs(ConfigParser* cp, const char* ld_config_file_path, F on_dir) {
   while (true) {
     std::string name;
     std::string value;
     std::string error;
 
-    int result = cp.next_token(&name, &value, &error);
+    int result = cp->next_token(&name, &value, &error);
     if (result == ConfigParser::kError) {
       DL_WARN("%s:%zd: warning: couldn't parse %s (ignoring this line)",
               ld_config_file_path,
-              cp.lineno(),
+              cp->lineno(),
               error.c_str());
       continue;
     }
@@ -216,7 +207,7 @@ static bool parse_config_file(const char* ld_config_file_path,
         DL_WARN("%s:%zd: warning: unexpected property name \"%s\", "
                 "expected format dir.<section_name> (ignoring this line)",
                 ld_config_file_path,
-                cp.lineno(),
+                cp->lineno(),
                 name.c_str());
         continue;
       }
@@ -229,7 +220,7 @@ static bool parse_config_file(const char* ld_config_file_path,
       if (value.empty()) {
         DL_WARN("%s:%zd: warning: property value is empty (ignoring this line)",
                 ld_config_file_path,
-                cp.lineno());
+                cp->lineno());
         continue;
       }
 
@@ -252,26 +243,29 @@ static bool parse_config_file(const char* ld_config_file_path,
         // /data/local/tmp may attempt to stat /postinstall. See
         // http://b/120996057.
         LD_DEBUG(any, "%s:%zd: warning: path \"%s\" couldn't be resolved: %m",
-                 ld_config_file_path, cp.lineno(), value.c_str());
+                 ld_config_file_path, cp->lineno(), value.c_str());
         resolved_path = value;
       }
 
-      if (file_is_under_dir(binary_realpath, resolved_path)) {
-        section_name = name.substr(4);
-        break;
+      if (on_dir(resolved_path, name.substr(4))) {
+        return true;
       }
     }
   }
+}
 
-  LD_DEBUG(any, "[ Using config section \"%s\" ]", section_name.c_str());
-
+static bool parse_config_section(ConfigParser* cp,
+                                 const char* ld_config_file_path,
+                                 const std::string& section_name,
+                                 std::unordered_map<std::string, PropertyValue>* properties,
+                                 std::string* error_msg) {
   // skip everything until we meet a correct section
   while (true) {
     std::string name;
     std::string value;
     std::string error;
 
-    int result = cp.next_token(&name, &value, &error);
+    int result = cp->next_token(&name, &value, &error);
 
     if (result == ConfigParser::kSection && name == section_name) {
       break;
@@ -279,7 +273,7 @@ static bool parse_config_file(const char* ld_config_file_path,
 
     if (result == ConfigParser::kEndOfFile) {
       *error_msg = create_error_msg(ld_config_file_path,
-                                    cp.lineno(),
+                                    cp->lineno(),
                                     std::string("section \"") + section_name + "\" not found");
       return false;
     }
@@ -291,7 +285,7 @@ static bool parse_config_file(const char* ld_config_file_path,
     std::string value;
     std::string error;
 
-    int result = cp.next_token(&name, &value, &error);
+    int result = cp->next_token(&name, &value, &error);
 
     if (result == ConfigParser::kEndOfFile || result == ConfigParser::kSection) {
       break;
@@ -301,18 +295,18 @@ static bool parse_config_file(const char* ld_config_file_path,
       if (properties->contains(name)) {
         DL_WARN("%s:%zd: warning: redefining property \"%s\" (overriding previous value)",
                 ld_config_file_path,
-                cp.lineno(),
+                cp->lineno(),
                 name.c_str());
       }
 
-      (*properties)[name] = PropertyValue(std::move(value), cp.lineno());
+      (*properties)[name] = PropertyValue(std::move(value), cp->lineno());
     } else if (result == ConfigParser::kPropertyAppend) {
       if (!properties->contains(name)) {
         DL_WARN("%s:%zd: warning: appending to undefined property \"%s\" (treating as assignment)",
                 ld_config_file_path,
-                cp.lineno(),
+                cp->lineno(),
                 name.c_str());
-        (*properties)[name] = PropertyValue(std::move(value), cp.lineno());
+        (*properties)[name] = PropertyValue(std::move(value), cp->lineno());
       } else {
         if (android::base::EndsWith(name, ".links") ||
             android::base::EndsWith(name, ".namespaces")) {
@@ -321,13 +315,14 @@ static bool parse_config_file(const char* ld_config_file_path,
         } else if (android::base::EndsWith(name, ".paths") ||
                    android::base::EndsWith(name, ".shared_libs") ||
                    android::base::EndsWith(name, ".whitelisted") ||
-                   android::base::EndsWith(name, ".allowed_libs")) {
+                   android::base::EndsWith(name, ".allowed_libs") ||
+                   android::base::EndsWith(name, ".shared_relro.libs")) {
           value = ":" + value;
           (*properties)[name].append_value(std::move(value));
         } else {
           DL_WARN("%s:%zd: warning: += isn't allowed for property \"%s\" (ignoring)",
                   ld_config_file_path,
-                  cp.lineno(),
+                  cp->lineno(),
                   name.c_str());
         }
       }
@@ -336,7 +331,7 @@ static bool parse_config_file(const char* ld_config_file_path,
     if (result == ConfigParser::kError) {
       DL_WARN("%s:%zd: warning: couldn't parse %s (ignoring this line)",
               ld_config_file_path,
-              cp.lineno(),
+              cp->lineno(),
               error.c_str());
       continue;
     }
@@ -345,6 +340,38 @@ static bool parse_config_file(const char* ld_config_file_path,
   return true;
 }
 
+static bool parse_config_file(const char* ld_config_file_path,
+                              const char* binary_realpath,
+                              std::unordered_map<std::string, PropertyValue>* properties,
+                              std::string* error_msg) {
+  std::string content;
+  if (!android::base::ReadFileToString(ld_config_file_path, &content)) {
+    if (errno != ENOENT) {
+      *error_msg = std::string("error reading file \"") +
+                   ld_config_file_path + "\": " + strerror(errno);
+    }
+    return false;
+  }
+
+  ConfigParser cp(std::move(content));
+
+  std::string section_name;
+  auto match_binary = [&](const std::string& resolved_path, const std::string& name) {
+    if (!file_is_under_dir(binary_realpath, resolved_path)) {
+      return false;
+    }
+    section_name = name;
+    return true;
+  };
+  if (!parse_config_dirs(&cp, ld_config_file_path, match_binary)) {
+    return false;
+  }
+
+  LD_DEBUG(any, "[ Using config section \"%s\" ]", section_name.c_str());
+
+  return parse_config_section(&cp, ld_config_file_path, section_name, properties, error_msg);
+}
+
 static Config g_config;
 
 static constexpr const char* kDefaultConfigName = "default";
@@ -454,33 +481,510 @@ class Properties {
   DISALLOW_IMPLICIT_CONSTRUCTORS(Properties);
 };
 
-bool Config::read_binary_config(const char* ld_config_file_path,
-                                      const char* binary_realpath,
-                                      bool is_asan,
-                                      bool is_hwasan,
-                                      const Config** config,
-                                      std::string* error_msg) {
-  g_config.clear();
+// The compiled config format. Everything is in native byte order; the header is
+// followed by the dir, section, namespace, link and string list tables (in that
+// order), and then by the string table. Strings are referred to by their offset
+// in the string table, and string lists by a range of string list items.
+static constexpr char kCompiledConfigMagic[4] = {'L', 'D', 'C', 'B'};
+static constexpr uint32_t kCompiledConfigVersion = 5;
+
+static constexpr uint32_t kCompiledConfigLp64 = 1 << 0;
+static constexpr uint32_t kCompiledConfigAsan = 1 << 1;
+static constexpr uint32_t kCompiledConfigHwasan = 1 << 2;
+
+static constexpr uint32_t kCompiledSectionUseText = 1 << 0;
+
+static constexpr uint32_t kCompiledNamespaceIsolated = 1 << 0;
+static constexpr uint32_t kCompiledNamespaceVisible = 1 << 1;
+static constexpr uint32_t kCompiledNamespaceConcurrentConstructors = 1 << 2;
+
+static constexpr uint32_t kCompiledLinkAllowAllSharedLibs = 1 << 0;
+
+struct CompiledConfigHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t flags;
+  uint32_t vndk_version;
+  // The identity of the text config file this was compiled from.
+  uint64_t source_dev;
+  uint64_t source_ino;
+  int64_t source_size;
+  int64_t source_mtime_ns;
+  // Unlike the mtime, this can't be set back from userspace, so it changes
+  // whenever the file is rewritten.
+  int64_t source_ctime_ns;
+  uint32_t dir_count;
+  uint32_t section_count;
+  uint32_t namespace_count;
+  uint32_t link_count;
+  uint32_t string_list_item_count;
+  uint32_t string_table_size;
+};
 
-  std::unordered_map<std::string, PropertyValue> property_map;
-  if (!parse_config_file(ld_config_file_path, binary_realpath, &property_map, error_msg)) {
+struct CompiledDir {
+  uint32_t path;
+  uint32_t section;
+};
+
+struct CompiledSection {
+  uint32_t name;
+  uint32_t flags;
+  uint32_t target_sdk_version;
+  uint32_t first_namespace;
+  uint32_t namespace_count;
+};
+
+struct CompiledStringList {
+  uint32_t first;
+  uint32_t count;
+};
+
+struct CompiledNamespace {
+  uint32_t name;
+  uint32_t flags;
+  CompiledStringList search_paths;
+  CompiledStringList permitted_paths;
+  CompiledStringList allowed_libs;
+  CompiledStringList shared_relro_libs;
+  uint32_t shared_relro_dir;
+  uint32_t first_link;
+  uint32_t link_count;
+};
+
+struct CompiledLink {
+  uint32_t ns_name;
+  uint32_t shared_libs;
+  uint32_t flags;
+};
+
+static bool g_write_compiled_config_on_parse = false;
+
+void Config::set_write_compiled_config_on_parse(bool enable) {
+  g_write_compiled_config_on_parse = enable;
+}
+
+static uint32_t compiled_config_flags(bool is_asan, bool is_hwasan) {
+  uint32_t flags = 0;
+#if defined(__LP64__)
+  flags |= kCompiledConfigLp64;
+#endif
+  if (is_asan) flags |= kCompiledConfigAsan;
+  if (is_hwasan) flags |= kCompiledConfigHwasan;
+  return flags;
+}
+
+static int64_t timespec_ns(const timespec& ts) {
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// The compiled form is used instead of the text, so only trust one that nobody
+// but root or the owner of the text can have written.
+static bool is_trusted_compiled_config(const struct stat& st, const struct stat& source_stat,
+                                       const std::string& path) {
+  if (!S_ISREG(st.st_mode)) {
+    return false;
+  }
+  if ((st.st_uid != 0 && st.st_uid != source_stat.st_uid) ||
+      (st.st_mode & (S_IWGRP | S_IWOTH)) != 0) {
+    LD_DEBUG(any, "[ Ignoring compiled linker config \"%s\" with uid %d and mode %o ]",
+             path.c_str(), static_cast<int>(st.st_uid), static_cast<unsigned>(st.st_mode & 07777));
     return false;
   }
+  return true;
+}
 
-  Properties properties(std::move(property_map));
+std::string Config::get_compiled_config_path(const char* ld_config_file_path,
+                                             bool is_asan,
+                                             bool is_hwasan) {
+  std::string path = ld_config_file_path;
+  if (android::base::EndsWith(path, ".txt")) {
+    path.resize(path.size() - 4);
+  }
+  path += std::string(".") + kLibPath;
+  if (is_asan) {
+    path += ".asan";
+  } else if (is_hwasan) {
+    path += ".hwasan";
+  }
+  return path + ".bin";
+}
 
-  auto failure_guard = android::base::make_scope_guard([] { g_config.clear(); });
+// Builds the compiled form in memory; see write_compiled_config().
+class CompiledConfigWriter {
+ public:
+  CompiledConfigWriter() {
+    // Offset 0 is the empty string.
+    string_table_.push_back('\0');
+  }
 
+  void add_dir(const std::string& path, const std::string& section_name) {
+    auto it = section_indexes_.find(section_name);
+    if (it == section_indexes_.end()) {
+      it = section_indexes_.emplace(section_name, sections_.size()).first;
+      sections_.push_back({add_string(section_name), kCompiledSectionUseText, 0, 0, 0});
+    }
+    dirs_.push_back({add_string(path), it->second});
+  }
+
+  const std::unordered_map<std::string, uint32_t>& section_indexes() const {
+    return section_indexes_;
+  }
+
+  void set_section_config(uint32_t section, const Config& config) {
+    CompiledSection& compiled_section = sections_[section];
+    compiled_section.flags &= ~kCompiledSectionUseText;
+    compiled_section.target_sdk_version = config.target_sdk_version();
+    compiled_section.first_namespace = namespaces_.size();
+    compiled_section.namespace_count = config.namespace_configs().size();
+
+    for (const auto& ns_config : config.namespace_configs()) {
+      CompiledNamespace ns = {};
+      ns.name = add_string(ns_config->name());
+      if (ns_config->isolated()) ns.flags |= kCompiledNamespaceIsolated;
+      if (ns_config->visible()) ns.flags |= kCompiledNamespaceVisible;
+      if (ns_config->concurrent_constructors()) {
+        ns.flags |= kCompiledNamespaceConcurrentConstructors;
+      }
+      ns.search_paths = add_string_list(ns_config->search_paths());
+      ns.permitted_paths = add_string_list(ns_config->permitted_paths());
+      ns.allowed_libs = add_string_list(ns_config->allowed_libs());
+      ns.shared_relro_libs = add_string_list(ns_config->shared_relro_libs());
+      ns.shared_relro_dir = add_string(ns_config->shared_relro_dir());
+      ns.first_link = links_.size();
+      ns.link_count = ns_config->links().size();
+      for (const auto& link : ns_config->links()) {
+        links_.push_back({add_string(link.ns_name()), add_string(link.shared_libs()),
+                          link.allow_all_shared_libs() ? kCompiledLinkAllowAllSharedLibs : 0});
+      }
+      namespaces_.push_back(ns);
+    }
+  }
+
+  std::string finish(CompiledConfigHeader header) {
+    header.vndk_version = add_string(Config::get_vndk_version_string('-'));
+    header.dir_count = dirs_.size();
+    header.section_count = sections_.size();
+    header.namespace_count = namespaces_.size();
+    header.link_count = links_.size();
+    header.string_list_item_count = string_list_items_.size();
+    header.string_table_size = string_table_.size();
+
+    std::string result;
+    append(&result, &header, 1);
+    append(&result, dirs_.data(), dirs_.size());
+    append(&result, sections_.data(), sections_.size());
+    append(&result, namespaces_.data(), namespaces_.size());
+    append(&result, links_.data(), links_.size());
+    append(&result, string_list_items_.data(), string_list_items_.size());
+    result += string_table_;
+    return result;
+  }
+
+ private:
+  uint32_t add_string(const std::string& str) {
+    auto it = string_offsets_.find(str);
+    if (it != string_offsets_.end()) {
+      return it->second;
+    }
+    uint32_t offset = str.empty() ? 0 : string_table_.size();
+    if (!str.empty()) {
+      string_table_ += str;
+      string_table_.push_back('\0');
+    }
+    string_offsets_.emplace(str, offset);
+    return offset;
+  }
+
+  CompiledStringList add_string_list(const std::vector<std::string>& strings) {
+    CompiledStringList list = {static_cast<uint32_t>(string_list_items_.size()),
+                               static_cast<uint32_t>(strings.size())};
+    for (const auto& str : strings) {
+      string_list_items_.push_back(add_string(str));
+    }
+    return list;
+  }
+
+  template <typename T>
+  static void append(std::string* out, const T* items, size_t count) {
+    out->append(reinterpret_cast<const char*>(items), count * sizeof(T));
+  }
+
+  std::vector<CompiledDir> dirs_;
+  std::vector<CompiledSection> sections_;
+  std::vector<CompiledNamespace> namespaces_;
+  std::vector<CompiledLink> links_;
+  std::vector<uint32_t> string_list_items_;
+  std::string string_table_;
+  std::unordered_map<std::string, uint32_t> string_offsets_;
+  std::unordered_map<std::string, uint32_t> section_indexes_;
+};
+
+bool Config::write_compiled_config(const char* ld_config_file_path,
+                                   bool is_asan,
+                                   bool is_hwasan,
+                                   std::string* error_msg) {
+  struct stat source_stat;
+  std::string content;
+  if (stat(ld_config_file_path, &source_stat) != 0 ||
+      !android::base::ReadFileToString(ld_config_file_path, &content)) {
+    *error_msg = std::string("error reading file \"") + ld_config_file_path + "\": " +
+                 strerror(errno);
+    return false;
+  }
+
+  CompiledConfigWriter writer;
+  ConfigParser dir_parser{std::string(content)};
+  parse_config_dirs(&dir_parser, ld_config_file_path,
+                    [&](const std::string& resolved_path, const std::string& section_name) {
+                      writer.add_dir(resolved_path, section_name);
+                      return false;
+                    });
+
+  for (const auto& [section_name, section] : writer.section_indexes()) {
+    // Errors are left for read_binary_config() to report when the text is
+    // parsed for a binary that uses this section.
+    std::unordered_map<std::string, PropertyValue> property_map;
+    std::string section_error;
+    ConfigParser section_parser{std::string(content)};
+    if (!parse_config_section(&section_parser, ld_config_file_path, section_name, &property_map,
+                              &section_error)) {
+      continue;
+    }
+
+    Properties properties(std::move(property_map));
+    // The target SDK version comes from a file next to each binary.
+    if (properties.get_bool("enable.target.sdk.version")) {
+      continue;
+    }
+
+    Config section_config;
+    if (!section_config.init_from_properties(&properties, ld_config_file_path, nullptr, is_asan,
+                                             is_hwasan, &section_error)) {
+      continue;
+    }
+    writer.set_section_config(section, section_config);
+  }
+
+  CompiledConfigHeader header = {};
+  memcpy(header.magic, kCompiledConfigMagic, sizeof(header.magic));
+  header.version = kCompiledConfigVersion;
+  header.flags = compiled_config_flags(is_asan, is_hwasan);
+  header.source_dev = source_stat.st_dev;
+  header.source_ino = source_stat.st_ino;
+  header.source_size = source_stat.st_size;
+  header.source_mtime_ns = timespec_ns(source_stat.st_mtim);
+  header.source_ctime_ns = timespec_ns(source_stat.st_ctim);
+
+  // Write to a temporary file and rename it into place, so that concurrent
+  // readers only ever see a complete file.
+  std::string path = get_compiled_config_path(ld_config_file_path, is_asan, is_hwasan);
+  std::string tmp_path = path + ".tmp." + std::to_string(getpid());
+  // See is_trusted_compiled_config().
+  if (!android::base::WriteStringToFile(writer.finish(header), tmp_path, 0644, geteuid(),
+                                        getegid()) ||
+      rename(tmp_path.c_str(), path.c_str()) != 0) {
+    *error_msg = std::string("error writing file \"") + path + "\": " + strerror(errno);
+    unlink(tmp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+// A bounds-checked view of a mapped compiled config.
+class CompiledConfigView {
+ public:
+  bool init(const uint8_t* data, size_t size) {
+    if (size < sizeof(CompiledConfigHeader)) return false;
+    header_ = reinterpret_cast<const CompiledConfigHeader*>(data);
+    size_t offset = sizeof(CompiledConfigHeader);
+    if (!take(data, size, &offset, header_->dir_count, &dirs_) ||
+        !take(data, size, &offset, header_->section_count, &sections_) ||
+        !take(data, size, &offset, header_->namespace_count, &namespaces_) ||
+        !take(data, size, &offset, header_->link_count, &links_) ||
+        !take(data, size, &offset, header_->string_list_item_count, &string_list_items_) ||
+        !take(data, size, &offset, header_->string_table_size, &string_table_)) {
+      return false;
+    }
+    // Every string offset is checked against the table size, and the table
+    // ends with a NUL, so every string is terminated.
+    return offset == size && header_->string_table_size != 0 &&
+           string_table_[header_->string_table_size - 1] == '\0';
+  }
+
+  const CompiledConfigHeader& header() const { return *header_; }
+
+  const char* string(uint32_t offset) const {
+    return offset < header_->string_table_size ? string_table_ + offset : nullptr;
+  }
+
+  bool string_list(const CompiledStringList& list, std::vector<std::string>* strings) const {
+    if (list.first > header_->string_list_item_count ||
+        list.count > header_->string_list_item_count - list.first) {
+      return false;
+    }
+    strings->clear();
+    for (uint32_t i = 0; i < list.count; ++i) {
+      const char* str = string(string_list_items_[list.first + i]);
+      if (str == nullptr) return false;
+      strings->push_back(str);
+    }
+    return true;
+  }
+
+  const CompiledDir* dirs() const { return dirs_; }
+  const CompiledSection* sections() const { return sections_; }
+  const CompiledNamespace* namespaces() const { return namespaces_; }
+  const CompiledLink* links() const { return links_; }
+
+ private:
+  template <typename T>
+  static bool take(const uint8_t* data, size_t size, size_t* offset, uint32_t count,
+                   const T** items) {
+    if (count > (size - *offset) / sizeof(T)) return false;
+    *items = reinterpret_cast<const T*>(data + *offset);
+    *offset += count * sizeof(T);
+    return true;
+  }
+
+  const CompiledConfigHeader* header_ = nullptr;
+  const CompiledDir* dirs_ = nullptr;
+  const CompiledSection* sections_ = nullptr;
+  const CompiledNamespace* namespaces_ = nullptr;
+  const CompiledLink* links_ = nullptr;
+  const uint32_t* string_list_items_ = nullptr;
+  const char* string_table_ = nullptr;
+};
+
+Config::CompiledConfigStatus Config::read_compiled_config(const char* ld_config_file_path,
+                                                          const char* binary_realpath,
+                                                          bool is_asan,
+                                                          bool is_hwasan) {
+  struct stat source_stat;
+  if (stat(ld_config_file_path, &source_stat) != 0) {
+    return CompiledConfigStatus::kUnusable;
+  }
+  std::string path = get_compiled_config_path(ld_config_file_path, is_asan, is_hwasan);
+  int fd = TEMP_FAILURE_RETRY(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+  if (fd == -1) {
+    return CompiledConfigStatus::kUnusable;
+  }
+  struct stat st;
+  void* map = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && is_trusted_compiled_config(st, source_stat, path) &&
+      st.st_size > 0) {
+    map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (map == MAP_FAILED) {
+    return CompiledConfigStatus::kUnusable;
+  }
+  auto unmap_guard = android::base::make_scope_guard([&] { munmap(map, st.st_size); });
+
+  CompiledConfigView view;
+  if (!view.init(static_cast<const uint8_t*>(map), st.st_size) ||
+      memcmp(view.header().magic, kCompiledConfigMagic, sizeof(kCompiledConfigMagic)) != 0 ||
+      view.header().version != kCompiledConfigVersion ||
+      view.header().flags != compiled_config_flags(is_asan, is_hwasan) ||
+      view.header().source_dev != static_cast<uint64_t>(source_stat.st_dev) ||
+      view.header().source_ino != static_cast<uint64_t>(source_stat.st_ino) ||
+      view.header().source_size != static_cast<int64_t>(source_stat.st_size) ||
+      view.header().source_mtime_ns != timespec_ns(source_stat.st_mtim) ||
+      view.header().source_ctime_ns != timespec_ns(source_stat.st_ctim)) {
+    LD_DEBUG(any, "[ Ignoring compiled linker config \"%s\": missing, corrupt or out of date ]",
+             path.c_str());
+    return CompiledConfigStatus::kUnusable;
+  }
+  const char* vndk_version = view.string(view.header().vndk_version);
+  if (vndk_version == nullptr || get_vndk_version_string('-') != vndk_version) {
+    return CompiledConfigStatus::kUnusable;
+  }
+
+  const CompiledSection* section = nullptr;
+  for (uint32_t i = 0; i < view.header().dir_count; ++i) {
+    const CompiledDir& dir = view.dirs()[i];
+    const char* dir_path = view.string(dir.path);
+    if (dir_path == nullptr || dir.section >= view.header().section_count) {
+      return CompiledConfigStatus::kUnusable;
+    }
+    if (file_is_under_dir(binary_realpath, dir_path)) {
+      section = &view.sections()[dir.section];
+      break;
+    }
+  }
+  if (section == nullptr) {
+    return CompiledConfigStatus::kNoSection;
+  }
+  if ((section->flags & kCompiledSectionUseText) != 0 ||
+      section->first_namespace > view.header().namespace_count ||
+      section->namespace_count > view.header().namespace_count - section->first_namespace) {
+    return CompiledConfigStatus::kUnusable;
+  }
+
+  LD_DEBUG(any, "[ Using config section \"%s\" from \"%s\" ]", view.string(section->name),
+           path.c_str());
+
+  auto failure_guard = android::base::make_scope_guard([this] { clear(); });
+  set_target_sdk_version(section->target_sdk_version);
+  for (uint32_t i = 0; i < section->namespace_count; ++i) {
+    const CompiledNamespace& ns = view.namespaces()[section->first_namespace + i];
+    const char* name = view.string(ns.name);
+    if (name == nullptr || ns.first_link > view.header().link_count ||
+        ns.link_count > view.header().link_count - ns.first_link) {
+      return CompiledConfigStatus::kUnusable;
+    }
+
+    NamespaceConfig* ns_config = create_namespace_config(name);
+    ns_config->set_isolated((ns.flags & kCompiledNamespaceIsolated) != 0);
+    ns_config->set_visible((ns.flags & kCompiledNamespaceVisible) != 0);
+    ns_config->set_concurrent_constructors(
+        (ns.flags & kCompiledNamespaceConcurrentConstructors) != 0);
+
+    std::vector<std::string> strings;
+    if (!view.string_list(ns.search_paths, &strings)) return CompiledConfigStatus::kUnusable;
+    ns_config->set_search_paths(std::move(strings));
+    if (!view.string_list(ns.permitted_paths, &strings)) return CompiledConfigStatus::kUnusable;
+    ns_config->set_permitted_paths(std::move(strings));
+    if (!view.string_list(ns.allowed_libs, &strings)) return CompiledConfigStatus::kUnusable;
+    ns_config->set_allowed_libs(std::move(strings));
+    if (!view.string_list(ns.shared_relro_libs, &strings)) return CompiledConfigStatus::kUnusable;
+    ns_config->set_shared_relro_libs(std::move(strings));
+    const char* shared_relro_dir = view.string(ns.shared_relro_dir);
+    if (shared_relro_dir == nullptr) return CompiledConfigStatus::kUnusable;
+    ns_config->set_shared_relro_dir(shared_relro_dir);
+
+    for (uint32_t j = 0; j < ns.link_count; ++j) {
+      const CompiledLink& link = view.links()[ns.first_link + j];
+      const char* ns_name = view.string(link.ns_name);
+      const char* shared_libs = view.string(link.shared_libs);
+      if (ns_name == nullptr || shared_libs == nullptr) return CompiledConfigStatus::kUnusable;
+      ns_config->add_namespace_link(ns_name, shared_libs,
+                                    (link.flags & kCompiledLinkAllowAllSharedLibs) != 0);
+    }
+  }
+
+  if (default_namespace_config() == nullptr) {
+    return CompiledConfigStatus::kUnusable;
+  }
+  failure_guard.Disable();
+  return CompiledConfigStatus::kLoaded;
+}
+
+bool Config::init_from_properties(Properties* properties,
+                                  const char* ld_config_file_path,
+                                  const char* binary_realpath,
+                                  bool is_asan,
+                                  bool is_hwasan,
+                                  std::string* error_msg) {
   std::unordered_map<std::string, NamespaceConfig*> namespace_configs;
 
-  namespace_configs[kDefaultConfigName] = g_config.create_namespace_config(kDefaultConfigName);
+  namespace_configs[kDefaultConfigName] = create_namespace_config(kDefaultConfigName);
 
-  std::vector<std::string> additional_namespaces = properties.get_strings(kPropertyAdditionalNamespaces);
+  std::vector<std::string> additional_namespaces = properties->get_strings(kPropertyAdditionalNamespaces);
   for (const auto& name : additional_namespaces) {
-    namespace_configs[name] = g_config.create_namespace_config(name);
+    namespace_configs[name] = create_namespace_config(name);
   }
 
-  bool versioning_enabled = properties.get_bool("enable.target.sdk.version");
+  bool versioning_enabled = properties->get_bool("enable.target.sdk.version");
   int target_sdk_version = __ANDROID_API__;
   if (versioning_enabled) {
     std::string version_file = dirname(binary_realpath) + "/.version";
@@ -499,7 +1003,7 @@ bool Config::read_binary_config(const char* ld_config_file_path,
       int result = strtol(content_str, &end, 10);
       if (errno == 0 && *end == '\0' && result > 0) {
         target_sdk_version = result;
-        properties.set_target_sdk_version(target_sdk_version);
+        properties->set_target_sdk_version(target_sdk_version);
       } else {
         *error_msg = std::string("invalid version \"") + version_file + "\": \"" + content +"\"";
         return false;
@@ -507,7 +1011,7 @@ bool Config::read_binary_config(const char* ld_config_file_path,
     }
   }
 
-  g_config.set_target_sdk_version(target_sdk_version);
+  set_target_sdk_version(target_sdk_version);
 
   for (const auto& ns_config_it : namespace_configs) {
     auto& name = ns_config_it.first;
@@ -517,7 +1021,7 @@ bool Config::read_binary_config(const char* ld_config_file_path,
 
     size_t lineno = 0;
     std::vector<std::string> linked_namespaces =
-        properties.get_strings(property_name_prefix + ".links", &lineno);
+        properties->get_strings(property_name_prefix + ".links", &lineno);
 
     for (const auto& linked_ns_name : linked_namespaces) {
       if (!namespace_configs.contains(linked_ns_name)) {
@@ -527,10 +1031,10 @@ bool Config::read_binary_config(const char* ld_config_file_path,
         return false;
       }
 
-      bool allow_all_shared_libs = properties.get_bool(property_name_prefix + ".link." +
+      bool allow_all_shared_libs = properties->get_bool(property_name_prefix + ".link." +
                                                        linked_ns_name + ".allow_all_shared_libs");
 
-      std::string shared_libs = properties.get_string(property_name_prefix +
+      std::string shared_libs = properties->get_string(property_name_prefix +
                                                       ".link." +
                                                       linked_ns_name +
                                                       ".shared_libs", &lineno);
@@ -557,12 +1061,14 @@ bool Config::read_binary_config(const char* ld_config_file_path,
       ns_config->add_namespace_link(linked_ns_name, shared_libs, allow_all_shared_libs);
     }
 
-    ns_config->set_isolated(properties.get_bool(property_name_prefix + ".isolated"));
-    ns_config->set_visible(properties.get_bool(property_name_prefix + ".visible"));
+    ns_config->set_isolated(properties->get_bool(property_name_prefix + ".isolated"));
+    ns_config->set_visible(properties->get_bool(property_name_prefix + ".visible"));
+    ns_config->set_concurrent_constructors(
+        properties->get_bool(property_name_prefix + ".concurrent_constructors"));
 
     std::string allowed_libs =
-        properties.get_string(property_name_prefix + ".whitelisted", &lineno);
-    const std::string libs = properties.get_string(property_name_prefix + ".allowed_libs", &lineno);
+        properties->get_string(property_name_prefix + ".whitelisted", &lineno);
+    const std::string libs = properties->get_string(property_name_prefix + ".allowed_libs", &lineno);
     if (!allowed_libs.empty() && !libs.empty()) {
       allowed_libs += ":";
     }
@@ -571,6 +1077,30 @@ bool Config::read_binary_config(const char* ld_config_file_path,
       ns_config->set_allowed_libs(android::base::Split(allowed_libs, ":"));
     }
 
+    // RELRO sharing is only enabled when both the libraries and the directory that holds
+    // their serialized RELRO segments are given. The directory may use ${LIB} to keep the
+    // files of 32-bit and 64-bit processes apart. Sharing loads the libraries at the same
+    // address in every process for the rest of the boot, so it also has to be acknowledged
+    // explicitly with shared_relro.fixed_address.
+    size_t shared_relro_lineno = 0;
+    const std::string shared_relro_libs = properties->get_string(
+        property_name_prefix + ".shared_relro.libs", &shared_relro_lineno);
+    std::vector<std::string> shared_relro_dir =
+        properties->get_paths(property_name_prefix + ".shared_relro.dir", false, &lineno);
+    bool shared_relro_fixed_address =
+        properties->get_bool(property_name_prefix + ".shared_relro.fixed_address");
+    if (!shared_relro_libs.empty() && !shared_relro_fixed_address) {
+      DL_WARN("%s:%zu: warning: %s.shared_relro.libs is ignored without "
+              "%s.shared_relro.fixed_address = true",
+              ld_config_file_path, shared_relro_lineno, property_name_prefix.c_str(),
+              property_name_prefix.c_str());
+    }
+    if (!shared_relro_libs.empty() && shared_relro_fixed_address && !shared_relro_dir.empty() &&
+        !shared_relro_dir[0].empty()) {
+      ns_config->set_shared_relro_libs(android::base::Split(shared_relro_libs, ":"));
+      ns_config->set_shared_relro_dir(shared_relro_dir[0]);
+    }
+
     // these are affected by is_asan flag
     if (is_asan) {
       property_name_prefix += ".asan";
@@ -581,7 +1111,7 @@ bool Config::read_binary_config(const char* ld_config_file_path,
     // search paths are resolved (canonicalized). This is required mainly for
     // the case when /vendor is a symlink to /system/vendor, which is true for
     // non Treble-ized legacy devices.
-    ns_config->set_search_paths(properties.get_paths(property_name_prefix + ".search.paths", true));
+    ns_config->set_search_paths(properties->get_paths(property_name_prefix + ".search.paths", true));
 
     // However, for permitted paths, we are not required to resolve the paths
     // since they are only set for isolated namespaces, which implies the device
@@ -589,7 +1119,49 @@ bool Config::read_binary_config(const char* ld_config_file_path,
     // In fact, the resolving is causing an unexpected side effect of selinux
     // denials on some executables which are not allowed to access some of the
     // permitted paths.
-    ns_config->set_permitted_paths(properties.get_paths(property_name_prefix + ".permitted.paths", false));
+    ns_config->set_permitted_paths(properties->get_paths(property_name_prefix + ".permitted.paths", false));
+  }
+
+  return true;
+}
+
+bool Config::read_binary_config(const char* ld_config_file_path,
+                                      const char* binary_realpath,
+                                      bool is_asan,
+                                      bool is_hwasan,
+                                      const Config** config,
+                                      std::string* error_msg) {
+  g_config.clear();
+
+  switch (g_config.read_compiled_config(ld_config_file_path, binary_realpath, is_asan, is_hwasan)) {
+    case CompiledConfigStatus::kLoaded:
+      *config = &g_config;
+      return true;
+    case CompiledConfigStatus::kNoSection:
+      return false;
+    case CompiledConfigStatus::kUnusable:
+      break;
+  }
+
+  std::unordered_map<std::string, PropertyValue> property_map;
+  if (!parse_config_file(ld_config_file_path, binary_realpath, &property_map, error_msg)) {
+    return false;
+  }
+
+  Properties properties(std::move(property_map));
+
+  auto failure_guard = android::base::make_scope_guard([] { g_config.clear(); });
+
+  if (!g_config.init_from_properties(&properties, ld_config_file_path, binary_realpath, is_asan,
+                                     is_hwasan, error_msg)) {
+    return false;
+  }
+
+  if (g_write_compiled_config_on_parse) {
+    std::string compile_error;
+    if (!write_compiled_config(ld_config_file_path, is_asan, is_hwasan, &compile_error)) {
+      LD_DEBUG(any, "[ Couldn't write compiled linker config: %s ]", compile_error.c_str());
+    }
   }
 
   failure_guard.Disable();
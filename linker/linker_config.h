@@ -75,7 +75,7 @@ class NamespaceLinkConfig {
 class NamespaceConfig {
  public:
   explicit NamespaceConfig(const std::string& name)
-      : name_(name), isolated_(false), visible_(false)
+      : name_(name), isolated_(false), visible_(false), concurrent_constructors_(false)
   {}
 
   const char* name() const {
@@ -90,6 +90,10 @@ class NamespaceConfig {
     return visible_;
   }
 
+  bool concurrent_constructors() const {
+    return concurrent_constructors_;
+  }
+
   const std::vector<std::string>& search_paths() const {
     return search_paths_;
   }
@@ -100,6 +104,10 @@ class NamespaceConfig {
 
   const std::vector<std::string>& allowed_libs() const { return allowed_libs_; }
 
+  const std::vector<std::string>& shared_relro_libs() const { return shared_relro_libs_; }
+
+  const std::string& shared_relro_dir() const { return shared_relro_dir_; }
+
   const std::vector<NamespaceLinkConfig>& links() const {
     return namespace_links_;
   }
@@ -117,6 +125,10 @@ class NamespaceConfig {
     visible_ = visible;
   }
 
+  void set_concurrent_constructors(bool concurrent_constructors) {
+    concurrent_constructors_ = concurrent_constructors;
+  }
+
   void set_search_paths(std::vector<std::string>&& search_paths) {
     search_paths_ = std::move(search_paths);
   }
@@ -129,18 +141,31 @@ class NamespaceConfig {
     allowed_libs_ = std::move(allowed_libs);
   }
 
+  void set_shared_relro_libs(std::vector<std::string>&& shared_relro_libs) {
+    shared_relro_libs_ = std::move(shared_relro_libs);
+  }
+
+  void set_shared_relro_dir(const std::string& shared_relro_dir) {
+    shared_relro_dir_ = shared_relro_dir;
+  }
+
  private:
   const std::string name_;
   bool isolated_;
   bool visible_;
+  bool concurrent_constructors_;
   std::vector<std::string> search_paths_;
   std::vector<std::string> permitted_paths_;
   std::vector<std::string> allowed_libs_;
+  std::vector<std::string> shared_relro_libs_;
+  std::string shared_relro_dir_;
   std::vector<NamespaceLinkConfig> namespace_links_;
 
   DISALLOW_IMPLICIT_CONSTRUCTORS(NamespaceConfig);
 };
 
+class Properties;
+
 class Config {
  public:
   Config() : target_sdk_version_(__ANDROID_API__) {}
@@ -163,6 +188,9 @@ class Config {
   // most one configuration.
   // Returns false in case of an error. If binary config was not found
   // sets *config = nullptr.
+  //
+  // If an up-to-date compiled form of the config file exists (see
+  // write_compiled_config()), it is used instead of parsing the text.
   static bool read_binary_config(const char* ld_config_file_path,
                                  const char* binary_realpath,
                                  bool is_asan,
@@ -170,10 +198,50 @@ class Config {
                                  const Config** config,
                                  std::string* error_msg);
 
+  // Resolves every section of the config file and writes the result to
+  // get_compiled_config_path(). The compiled form records the identity of the
+  // text file (including its mtime and ctime) and the VNDK version, and is
+  // ignored once either changes, or if someone other than root or the owner of
+  // the text file can have written it.
+  // Sections that can't be resolved ahead of time (those using
+  // enable.target.sdk.version, or with errors) are marked so that
+  // read_binary_config() falls back to parsing the text for them.
+  static bool write_compiled_config(const char* ld_config_file_path,
+                                    bool is_asan,
+                                    bool is_hwasan,
+                                    std::string* error_msg);
+
+  // "ld.config.txt" -> "ld.config.lib64.bin" (or .lib64.asan.bin, ...): search
+  // paths depend on the ABI and the sanitizer mode.
+  static std::string get_compiled_config_path(const char* ld_config_file_path,
+                                              bool is_asan,
+                                              bool is_hwasan);
+
+  // When set, a successful parse of the text config also writes its compiled
+  // form if that is missing or out of date.
+  static void set_write_compiled_config_on_parse(bool enable);
+
   static std::string get_vndk_version_string(const char delimiter);
  private:
   void clear();
 
+  bool init_from_properties(Properties* properties,
+                            const char* ld_config_file_path,
+                            const char* binary_realpath,
+                            bool is_asan,
+                            bool is_hwasan,
+                            std::string* error_msg);
+
+  enum class CompiledConfigStatus {
+    kLoaded,
+    kNoSection,  // No dir.<section> matches the binary.
+    kUnusable,   // Missing, stale, corrupt, or the section has to be parsed from text.
+  };
+  CompiledConfigStatus read_compiled_config(const char* ld_config_file_path,
+                                            const char* binary_realpath,
+                                            bool is_asan,
+                                            bool is_hwasan);
+
   void set_target_sdk_version(int target_sdk_version) {
     target_sdk_version_ = target_sdk_version;
   }
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+
+#include <android-base/file.h>
+#include <android-base/stringprintf.h>
+#include <benchmark/benchmark.h>
+
+#include "linker_config.h"
+
+using android::base::StringAppendF;
+
+// A config shaped like a device's ld.config.txt: a handful of sections, each with a few
+// namespaces that have search and permitted paths and links to each other. The binary being
+// started is in the last section.
+static std::string make_config(const std::string& binary_dir) {
+  static const char* const kNamespaces[] = {"default", "sphal", "vndk", "vndk_in_system", "rs"};
+  constexpr size_t kSectionCount = 8;
+
+  std::string config;
+  for (size_t i = 0; i + 1 < kSectionCount; ++i) {
+    StringAppendF(&config, "dir.section%zu = /system/section%zu/bin\n", i, i);
+  }
+  StringAppendF(&config, "dir.section%zu = %s\n", kSectionCount - 1, binary_dir.c_str());
+
+  for (size_t i = 0; i < kSectionCount; ++i) {
+    StringAppendF(&config, "[section%zu]\n", i);
+    config += "additional.namespaces = sphal,vndk,vndk_in_system,rs\n";
+    for (const char* ns : kNamespaces) {
+      std::string prefix = std::string("namespace.") + ns;
+      StringAppendF(&config, "%s.isolated = true\n", prefix.c_str());
+      StringAppendF(&config, "%s.visible = true\n", prefix.c_str());
+      StringAppendF(&config, "%s.search.paths = /system/${LIB}\n", prefix.c_str());
+      StringAppendF(&config, "%s.search.paths += /vendor/${LIB}/%s\n", prefix.c_str(), ns);
+      StringAppendF(&config, "%s.search.paths += /odm/${LIB}/%s\n", prefix.c_str(), ns);
+      StringAppendF(&config, "%s.permitted.paths = /system/${LIB}/drm:/system/${LIB}/extractors\n",
+                    prefix.c_str());
+      StringAppendF(&config, "%s.permitted.paths += /vendor/${LIB}/%s/hw\n", prefix.c_str(), ns);
+      StringAppendF(&config, "%s.asan.search.paths = /data/asan/system/${LIB}:/system/${LIB}\n",
+                    prefix.c_str());
+      std::string links;
+      for (const char* other : kNamespaces) {
+        if (strcmp(ns, other) == 0) continue;
+        if (!links.empty()) links += ",";
+        links += other;
+        StringAppendF(&config, "%s.link.%s.shared_libs = libc.so:libm.so:libdl.so:liblog.so\n",
+                      prefix.c_str(), other);
+        StringAppendF(&config, "%s.link.%s.shared_libs += libc++.so:libz.so:libutils.so\n",
+                      prefix.c_str(), other);
+      }
+      StringAppendF(&config, "%s.links = %s\n", prefix.c_str(), links.c_str());
+    }
+  }
+  return config;
+}
+
+// Resolves the config for a binary from the text, or from its compiled form when `compiled`.
+static void BM_linker_config(benchmark::State& state, bool compiled) {
+  TemporaryDir binary_dir;
+  TemporaryFile config_file;
+  close(config_file.fd);
+  config_file.fd = -1;
+  if (!android::base::WriteStringToFile(make_config(binary_dir.path), config_file.path)) {
+    state.SkipWithError("couldn't write the config");
+    return;
+  }
+  std::string compiled_path = Config::get_compiled_config_path(config_file.path, false, false);
+  std::string error_msg;
+  if (compiled && !Config::write_compiled_config(config_file.path, false, false, &error_msg)) {
+    state.SkipWithError(error_msg.c_str());
+    return;
+  }
+
+  std::string binary_path = std::string(binary_dir.path) + "/some-binary";
+  for (auto _ : state) {
+    const Config* config = nullptr;
+    if (!Config::read_binary_config(config_file.path, binary_path.c_str(), false, false, &config,
+                                    &error_msg)) {
+      state.SkipWithError(error_msg.c_str());
+      break;
+    }
+    benchmark::DoNotOptimize(config);
+  }
+  unlink(compiled_path.c_str());
+}
+
+BENCHMARK_CAPTURE(BM_linker_config, text, false);
+BENCHMARK_CAPTURE(BM_linker_config, compiled, true);
@@ -26,9 +26,11 @@
  * SUCH DAMAGE.
  */
 
+#include <fcntl.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <gtest/gtest.h>
 
@@ -124,7 +126,10 @@ enum class SmokeTestType {
   Hwasan,
 };
 
-static void run_linker_config_smoke_test(SmokeTestType type) {
+// With `compiled`, the config is read back from its compiled form. That only
+// covers sections without enable.target.sdk.version, so the version file isn't
+// used either.
+static void run_linker_config_smoke_test(SmokeTestType type, bool compiled = false) {
   std::vector<std::string> expected_default_search_path;
   std::vector<std::string> expected_default_permitted_path;
   std::vector<std::string> expected_system_search_path;
@@ -167,7 +172,12 @@ static void run_linker_config_smoke_test(SmokeTestType type) {
   close(tmp_file.fd);
   tmp_file.fd = -1;
 
-  android::base::WriteStringToFile(config_str, tmp_file.path);
+  std::string content = config_str;
+  if (compiled) {
+    std::string versioning = "enable.target.sdk.version = true\n";
+    content.erase(content.find(versioning), versioning.size());
+  }
+  android::base::WriteStringToFile(content, tmp_file.path);
 
   TemporaryDir tmp_dir;
 
@@ -179,9 +189,22 @@ static void run_linker_config_smoke_test(SmokeTestType type) {
 
   ASSERT_TRUE(write_version(version_file, 113U)) << strerror(errno);
 
+  std::string compiled_path = Config::get_compiled_config_path(
+      tmp_file.path, type == SmokeTestType::Asan, type == SmokeTestType::Hwasan);
+  auto compiled_guard =
+      android::base::make_scope_guard([&compiled_path] { unlink(compiled_path.c_str()); });
+
+  std::string error_msg;
+  if (compiled) {
+    ASSERT_TRUE(Config::write_compiled_config(tmp_file.path,
+                                              type == SmokeTestType::Asan,
+                                              type == SmokeTestType::Hwasan,
+                                              &error_msg)) << error_msg;
+    ASSERT_EQ(0, access(compiled_path.c_str(), R_OK));
+  }
+
   // read config
   const Config* config = nullptr;
-  std::string error_msg;
   ASSERT_TRUE(Config::read_binary_config(tmp_file.path,
                                          executable_path.c_str(),
                                          type == SmokeTestType::Asan,
@@ -191,7 +214,7 @@ static void run_linker_config_smoke_test(SmokeTestType type) {
   ASSERT_TRUE(config != nullptr);
   ASSERT_TRUE(error_msg.empty());
 
-  ASSERT_EQ(113, config->target_sdk_version());
+  ASSERT_EQ(compiled ? __ANDROID_API__ : 113, config->target_sdk_version());
 
   const NamespaceConfig* default_ns_config = config->default_namespace_config();
   ASSERT_TRUE(default_ns_config != nullptr);
@@ -270,6 +293,222 @@ TEST(linker_config, hwasan_smoke) {
   run_linker_config_smoke_test(SmokeTestType::Hwasan);
 }
 
+TEST(linker_config, compiled_smoke) {
+  run_linker_config_smoke_test(SmokeTestType::None, true);
+}
+
+TEST(linker_config, compiled_asan_smoke) {
+  run_linker_config_smoke_test(SmokeTestType::Asan, true);
+}
+
+TEST(linker_config, compiled_hwasan_smoke) {
+  run_linker_config_smoke_test(SmokeTestType::Hwasan, true);
+}
+
+static bool read_default_ns_isolated(const char* config_path, const std::string& executable_path,
+                                     bool* isolated) {
+  const Config* config = nullptr;
+  std::string error_msg;
+  if (!Config::read_binary_config(config_path, executable_path.c_str(), false, false, &config,
+                                  &error_msg)) {
+    return false;
+  }
+  *isolated = config->default_namespace_config()->isolated();
+  return true;
+}
+
+TEST(linker_config, compiled_config_tracks_source) {
+  static const char config_str[] =
+    "dir.test = /data/local/tmp\n"
+    "[test]\n"
+    "namespace.default.isolated = true\n";
+  // The same length as config_str, and written with the same mtime below.
+  static const char changed_config_str[] =
+    "dir.test = /data/local/tmp\n"
+    "[test]\n"
+    "namespace.default.isolated = nope\n";
+
+  TemporaryFile tmp_file;
+  close(tmp_file.fd);
+  tmp_file.fd = -1;
+  ASSERT_TRUE(android::base::WriteStringToFile(config_str, tmp_file.path));
+
+  std::string compiled_path = Config::get_compiled_config_path(tmp_file.path, false, false);
+  auto compiled_guard =
+      android::base::make_scope_guard([&compiled_path] { unlink(compiled_path.c_str()); });
+
+  TemporaryDir tmp_dir;
+  std::string executable_path = std::string(tmp_dir.path) + "/some-binary";
+
+  std::string error_msg;
+  ASSERT_TRUE(Config::write_compiled_config(tmp_file.path, false, false, &error_msg)) << error_msg;
+
+  bool isolated = false;
+  ASSERT_TRUE(read_default_ns_isolated(tmp_file.path, executable_path, &isolated));
+  ASSERT_TRUE(isolated);
+
+  // Rewrite the text in place but keep its size and mtime: the ctime still
+  // changes, so the compiled form is stale and the text is parsed.
+  struct stat st;
+  ASSERT_EQ(0, stat(tmp_file.path, &st));
+  ASSERT_TRUE(android::base::WriteStringToFile(changed_config_str, tmp_file.path));
+  timespec times[2] = {st.st_atim, st.st_mtim};
+  ASSERT_EQ(0, utimensat(AT_FDCWD, tmp_file.path, times, 0));
+
+  ASSERT_TRUE(read_default_ns_isolated(tmp_file.path, executable_path, &isolated));
+  ASSERT_FALSE(isolated);
+}
+
+TEST(linker_config, compiled_config_corrupt) {
+  static const char config_str[] =
+    "dir.test = /data/local/tmp\n"
+    "[test]\n"
+    "namespace.default.isolated = true\n";
+
+  TemporaryFile tmp_file;
+  close(tmp_file.fd);
+  tmp_file.fd = -1;
+  ASSERT_TRUE(android::base::WriteStringToFile(config_str, tmp_file.path));
+
+  std::string compiled_path = Config::get_compiled_config_path(tmp_file.path, false, false);
+  auto compiled_guard =
+      android::base::make_scope_guard([&compiled_path] { unlink(compiled_path.c_str()); });
+
+  std::string error_msg;
+  ASSERT_TRUE(Config::write_compiled_config(tmp_file.path, false, false, &error_msg)) << error_msg;
+
+  // A truncated compiled config is ignored in favor of the text.
+  struct stat st;
+  ASSERT_EQ(0, stat(compiled_path.c_str(), &st));
+  ASSERT_EQ(0, truncate(compiled_path.c_str(), st.st_size - 1));
+
+  TemporaryDir tmp_dir;
+  std::string executable_path = std::string(tmp_dir.path) + "/some-binary";
+  bool isolated = false;
+  ASSERT_TRUE(read_default_ns_isolated(tmp_file.path, executable_path, &isolated));
+  ASSERT_TRUE(isolated);
+}
+
+static void run_shared_relro_test(bool compiled) {
+  static const char config_str[] =
+    "dir.test = /data/local/tmp\n"
+    "[test]\n"
+    "additional.namespaces = system,vendor\n"
+    "namespace.default.shared_relro.libs = libfoo.so\n"
+    "namespace.default.shared_relro.libs += libbar.so\n"
+    "namespace.default.shared_relro.dir = /data/misc/shared_relro/${LIB}\n"
+    "namespace.default.shared_relro.fixed_address = true\n"
+    // Without a directory, the list alone doesn't enable sharing.
+    "namespace.system.shared_relro.libs = libbaz.so\n"
+    "namespace.system.shared_relro.fixed_address = true\n"
+    // Nor without acknowledging the fixed load address.
+    "namespace.vendor.shared_relro.libs = libqux.so\n"
+    "namespace.vendor.shared_relro.dir = /data/misc/shared_relro/${LIB}\n";
+
+  TemporaryFile tmp_file;
+  close(tmp_file.fd);
+  tmp_file.fd = -1;
+  ASSERT_TRUE(android::base::WriteStringToFile(config_str, tmp_file.path));
+
+  std::string compiled_path = Config::get_compiled_config_path(tmp_file.path, false, false);
+  auto compiled_guard =
+      android::base::make_scope_guard([&compiled_path] { unlink(compiled_path.c_str()); });
+  std::string error_msg;
+  if (compiled) {
+    ASSERT_TRUE(Config::write_compiled_config(tmp_file.path, false, false, &error_msg))
+        << error_msg;
+  }
+
+  TemporaryDir tmp_dir;
+  std::string executable_path = std::string(tmp_dir.path) + "/some-binary";
+
+  const Config* config = nullptr;
+  ASSERT_TRUE(Config::read_binary_config(tmp_file.path, executable_path.c_str(), false, false,
+                                         &config, &error_msg)) << error_msg;
+  ASSERT_TRUE(config != nullptr);
+
+  const NamespaceConfig* default_ns_config = config->default_namespace_config();
+  ASSERT_TRUE(default_ns_config != nullptr);
+  ASSERT_EQ(std::vector<std::string>({"libfoo.so", "libbar.so"}),
+            default_ns_config->shared_relro_libs());
+  ASSERT_EQ(std::string("/data/misc/shared_relro/") + kLibPath,
+            default_ns_config->shared_relro_dir());
+
+  const NamespaceConfig* system_ns_config = nullptr;
+  const NamespaceConfig* vendor_ns_config = nullptr;
+  for (const auto& ns_config : config->namespace_configs()) {
+    if (std::string(ns_config->name()) == "system") {
+      system_ns_config = ns_config.get();
+    } else if (std::string(ns_config->name()) == "vendor") {
+      vendor_ns_config = ns_config.get();
+    }
+  }
+  ASSERT_TRUE(system_ns_config != nullptr);
+  ASSERT_TRUE(system_ns_config->shared_relro_libs().empty());
+  ASSERT_EQ("", system_ns_config->shared_relro_dir());
+
+  ASSERT_TRUE(vendor_ns_config != nullptr);
+  ASSERT_TRUE(vendor_ns_config->shared_relro_libs().empty());
+  ASSERT_EQ("", vendor_ns_config->shared_relro_dir());
+}
+
+TEST(linker_config, shared_relro) {
+  run_shared_relro_test(false);
+}
+
+TEST(linker_config, compiled_shared_relro) {
+  run_shared_relro_test(true);
+}
+
+static void run_concurrent_constructors_test(bool compiled) {
+  static const char config_str[] =
+    "dir.test = /data/local/tmp\n"
+    "[test]\n"
+    "additional.namespaces = plugins\n"
+    "namespace.plugins.concurrent_constructors = true\n";
+
+  TemporaryFile tmp_file;
+  close(tmp_file.fd);
+  tmp_file.fd = -1;
+  ASSERT_TRUE(android::base::WriteStringToFile(config_str, tmp_file.path));
+
+  std::string compiled_path = Config::get_compiled_config_path(tmp_file.path, false, false);
+  auto compiled_guard =
+      android::base::make_scope_guard([&compiled_path] { unlink(compiled_path.c_str()); });
+  std::string error_msg;
+  if (compiled) {
+    ASSERT_TRUE(Config::write_compiled_config(tmp_file.path, false, false, &error_msg))
+        << error_msg;
+  }
+
+  TemporaryDir tmp_dir;
+  std::string executable_path = std::string(tmp_dir.path) + "/some-binary";
+
+  const Config* config = nullptr;
+  ASSERT_TRUE(Config::read_binary_config(tmp_file.path, executable_path.c_str(), false, false,
+                                         &config, &error_msg)) << error_msg;
+  ASSERT_TRUE(config != nullptr);
+
+  ASSERT_FALSE(config->default_namespace_config()->concurrent_constructors());
+
+  const NamespaceConfig* plugins_ns_config = nullptr;
+  for (const auto& ns_config : config->namespace_configs()) {
+    if (std::string(ns_config->name()) == "plugins") {
+      plugins_ns_config = ns_config.get();
+    }
+  }
+  ASSERT_TRUE(plugins_ns_config != nullptr);
+  ASSERT_TRUE(plugins_ns_config->concurrent_constructors());
+}
+
+TEST(linker_config, concurrent_constructors) {
+  run_concurrent_constructors_test(false);
+}
+
+TEST(linker_config, compiled_concurrent_constructors) {
+  run_concurrent_constructors_test(true);
+}
+
 TEST(linker_config, ns_link_shared_libs_invalid_settings) {
   // This unit test ensures an error is emitted when a namespace link in ld.config.txt specifies
   // both shared_libs and allow_all_shared_libs.
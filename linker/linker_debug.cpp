@@ -42,6 +42,7 @@ void init_LD_DEBUG(const std::string& value) {
     else if (o == "cfi") g_linker_debug_config.cfi = true;
     else if (o == "dynamic") g_linker_debug_config.dynamic = true;
     else if (o == "lookup") g_linker_debug_config.lookup = true;
+    else if (o == "profile") g_linker_debug_config.profile = true;
     else if (o == "props") g_linker_debug_config.props = true;
     else if (o == "reloc") g_linker_debug_config.reloc = true;
     else if (o == "statistics") g_linker_debug_config.statistics = true;
@@ -51,6 +52,7 @@ void init_LD_DEBUG(const std::string& value) {
       g_linker_debug_config.cfi = true;
       g_linker_debug_config.dynamic = true;
       g_linker_debug_config.lookup = true;
+      g_linker_debug_config.profile = true;
       g_linker_debug_config.props = true;
       g_linker_debug_config.reloc = true;
       g_linker_debug_config.statistics = true;
@@ -62,9 +64,10 @@ void init_LD_DEBUG(const std::string& value) {
                      "  cfi         control flow integrity messages\n"
                      "  dynamic     dynamic section processing\n"
                      "  lookup      symbol lookup\n"
+                     "  profile     per-library relocation and constructor profile\n"
                      "  props       ELF property processing\n"
                      "  reloc       relocation resolution\n"
-                     "  statistics  relocation statistics\n"
+                     "  statistics  relocation, dlsym cache, allocator and CFI shadow statistics\n"
                      "  timing      timing information\n"
                      "\n"
                      "or 'all' for all of the above.\n");
@@ -72,8 +75,9 @@ void init_LD_DEBUG(const std::string& value) {
   }
   if (g_linker_debug_config.calls || g_linker_debug_config.cfi ||
       g_linker_debug_config.dynamic || g_linker_debug_config.lookup ||
-      g_linker_debug_config.props || g_linker_debug_config.reloc ||
-      g_linker_debug_config.statistics || g_linker_debug_config.timing) {
+      g_linker_debug_config.profile || g_linker_debug_config.props ||
+      g_linker_debug_config.reloc || g_linker_debug_config.statistics ||
+      g_linker_debug_config.timing) {
     g_linker_debug_config.any = true;
   }
 }
@@ -56,6 +56,8 @@ struct LinkerDebugConfig {
 
   bool timing;
   bool statistics;
+  // Per-library relocation and constructor profile.
+  bool profile;
 };
 
 extern LinkerDebugConfig g_linker_debug_config;
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "linker_dlsym_cache.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+
+#include "linker_debug.h"
+#include "linker_soinfo.h"
+
+// Direct-mapped, so a lookup only ever looks at one entry.
+static constexpr size_t kDlsymCacheSize = 256;
+
+// Each entry is a seqlock: an odd sequence number means an insertion is in progress. The fields
+// are atomics only so that concurrent readers don't race with an insertion; the sequence number
+// is what orders them.
+struct DlsymCacheEntry {
+  std::atomic<uint32_t> sequence;
+  std::atomic<uint32_t> generation;
+  std::atomic<uint32_t> gnu_hash;
+  std::atomic<soinfo*> handle_si;
+  std::atomic<soinfo*> found;
+  std::atomic<const ElfW(Sym)*> sym;
+};
+
+static DlsymCacheEntry g_dlsym_cache[kDlsymCacheSize];
+
+// Entries from an older generation are stale. Starts at 1 so zero-initialized entries never match.
+static std::atomic<uint32_t> g_dlsym_cache_generation = 1;
+
+static std::atomic<size_t> g_dlsym_cache_hits;
+static std::atomic<size_t> g_dlsym_cache_misses;
+
+static DlsymCacheEntry& dlsym_cache_entry(soinfo* handle_si, uint32_t gnu_hash) {
+  uintptr_t key = gnu_hash ^ (reinterpret_cast<uintptr_t>(handle_si) >> 4);
+  return g_dlsym_cache[key % kDlsymCacheSize];
+}
+
+static bool dlsym_cache_lookup_impl(soinfo* handle_si, SymbolName& symbol_name, soinfo** found,
+                                    const ElfW(Sym)** sym) {
+  uint32_t gnu_hash = symbol_name.gnu_hash();
+  DlsymCacheEntry& entry = dlsym_cache_entry(handle_si, gnu_hash);
+
+  uint32_t sequence = entry.sequence.load(std::memory_order_acquire);
+  if ((sequence & 1) != 0) {
+    return false;
+  }
+  uint32_t generation = entry.generation.load(std::memory_order_relaxed);
+  uint32_t entry_hash = entry.gnu_hash.load(std::memory_order_relaxed);
+  soinfo* entry_handle_si = entry.handle_si.load(std::memory_order_relaxed);
+  soinfo* entry_found = entry.found.load(std::memory_order_relaxed);
+  const ElfW(Sym)* entry_sym = entry.sym.load(std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (entry.sequence.load(std::memory_order_relaxed) != sequence) {
+    return false;
+  }
+
+  if (generation != g_dlsym_cache_generation.load(std::memory_order_relaxed) ||
+      entry_hash != gnu_hash || entry_handle_si != handle_si) {
+    return false;
+  }
+  // The generation check guarantees entry_found is still loaded; compare the actual names to
+  // rule out a hash collision.
+  if (strcmp(entry_found->get_string(entry_sym->st_name), symbol_name.get_name()) != 0) {
+    return false;
+  }
+
+  *found = entry_found;
+  *sym = entry_sym;
+  return true;
+}
+
+bool dlsym_cache_lookup(soinfo* handle_si, SymbolName& symbol_name, soinfo** found,
+                        const ElfW(Sym)** sym) {
+  bool hit = dlsym_cache_lookup_impl(handle_si, symbol_name, found, sym);
+  if (g_linker_debug_config.statistics) {
+    (hit ? g_dlsym_cache_hits : g_dlsym_cache_misses).fetch_add(1, std::memory_order_relaxed);
+  }
+  return hit;
+}
+
+void dlsym_cache_insert(soinfo* handle_si, SymbolName& symbol_name, soinfo* found,
+                        const ElfW(Sym)* sym) {
+  uint32_t gnu_hash = symbol_name.gnu_hash();
+  DlsymCacheEntry& entry = dlsym_cache_entry(handle_si, gnu_hash);
+
+  // If another thread is already updating this entry, let it win.
+  uint32_t sequence = entry.sequence.load(std::memory_order_relaxed);
+  if ((sequence & 1) != 0 ||
+      !entry.sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_relaxed)) {
+    return;
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+
+  entry.generation.store(g_dlsym_cache_generation.load(std::memory_order_relaxed),
+                         std::memory_order_relaxed);
+  entry.gnu_hash.store(gnu_hash, std::memory_order_relaxed);
+  entry.handle_si.store(handle_si, std::memory_order_relaxed);
+  entry.found.store(found, std::memory_order_relaxed);
+  entry.sym.store(sym, std::memory_order_relaxed);
+
+  entry.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void dlsym_cache_invalidate() {
+  g_dlsym_cache_generation.fetch_add(1, std::memory_order_relaxed);
+
+  if (g_linker_debug_config.statistics) {
+    size_t hits = g_dlsym_cache_hits.exchange(0, std::memory_order_relaxed);
+    size_t misses = g_dlsym_cache_misses.exchange(0, std::memory_order_relaxed);
+    if (hits != 0 || misses != 0) {
+      LD_DEBUG(statistics, "dlsym cache: %zu hits, %zu misses since the last invalidation", hits,
+               misses);
+    }
+  }
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <link.h>
+
+class SymbolName;
+struct soinfo;
+
+// A small, bounded cache of dlsym(handle, name) results, keyed by the handle's soinfo and the
+// symbol name, so that repeated lookups of the same pair skip the walk over the handle's
+// dependency tree. It is safe to use while holding g_dl_rwlock for reading: lookups and
+// insertions from concurrent readers never block each other (a racing insertion is dropped).
+//
+// Any loader call that takes g_dl_rwlock for writing may change which library a lookup resolves
+// to (by loading or unloading libraries, promoting them to RTLD_GLOBAL, or linking namespaces),
+// so it invalidates the whole cache.
+bool dlsym_cache_lookup(soinfo* handle_si, SymbolName& symbol_name, soinfo** found,
+                        const ElfW(Sym)** sym);
+void dlsym_cache_insert(soinfo* handle_si, SymbolName& symbol_name, soinfo* found,
+                        const ElfW(Sym)* sym);
+
+// Must be called with g_dl_rwlock held for writing. Reports the hit/miss counters under
+// LD_DEBUG=statistics.
+void dlsym_cache_invalidate();
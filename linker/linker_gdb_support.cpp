@@ -97,6 +97,22 @@ void notify_gdb_of_unload(link_map* map) {
   rtld_db_dlactivity();
 }
 
+// Removes a group of libraries that are unloaded together, with a single
+// RT_DELETE/RT_CONSISTENT pair of notifications rather than one per library.
+void notify_gdb_of_unloads(link_map* const* maps, size_t count) {
+  ScopedPthreadMutexLocker locker(&g__r_debug_mutex);
+
+  _r_debug.r_state = r_debug::RT_DELETE;
+  rtld_db_dlactivity();
+
+  for (size_t i = 0; i < count; ++i) {
+    remove_link_map_from_debug_map(maps[i]);
+  }
+
+  _r_debug.r_state = r_debug::RT_CONSISTENT;
+  rtld_db_dlactivity();
+}
+
 void notify_gdb_of_libraries() {
   _r_debug.r_state = r_debug::RT_ADD;
   rtld_db_dlactivity();
@@ -29,6 +29,7 @@
 #pragma once
 
 #include <link.h>
+#include <stddef.h>
 #include <sys/cdefs.h>
 
 __BEGIN_DECLS
@@ -37,6 +38,7 @@ void insert_link_map_into_debug_map(link_map* map);
 void remove_link_map_from_debug_map(link_map* map);
 void notify_gdb_of_load(link_map* map);
 void notify_gdb_of_unload(link_map* map);
+void notify_gdb_of_unloads(link_map* const* maps, size_t count);
 void notify_gdb_of_libraries();
 
 extern struct r_debug _r_debug;
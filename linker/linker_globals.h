@@ -29,8 +29,11 @@
 #pragma once
 
 #include "linker_debug.h"
+#include "linker_dlsym_cache.h"
+#include "linker_phdr_snapshot.h"
 
 #include <link.h>
+#include <pthread.h>
 #include <stddef.h>
 
 #include <string>
@@ -107,3 +110,64 @@ class DlErrorRestorer {
 
 __LIBC_HIDDEN__ extern bool g_is_ldd;
 __LIBC_HIDDEN__ extern pthread_mutex_t g_dl_mutex;
+// How many times the thread holding g_dl_mutex has locked it. dlopen() uses this to tell whether
+// an outer loader call on the same thread still relies on the mutex, and so whether it may
+// release the mutex to run or wait for constructors. Protected by g_dl_mutex.
+__LIBC_HIDDEN__ extern size_t g_dl_mutex_depth;
+
+// Takes g_dl_mutex, keeping g_dl_mutex_depth up to date.
+class ScopedDlMutexLock {
+ public:
+  ScopedDlMutexLock() {
+    pthread_mutex_lock(&g_dl_mutex);
+    ++g_dl_mutex_depth;
+  }
+  ~ScopedDlMutexLock() {
+    bool outermost = --g_dl_mutex_depth == 0;
+    pthread_mutex_unlock(&g_dl_mutex);
+    if (outermost) phdr_snapshot_reclaim_pending();
+  }
+};
+
+// Loader state that dlsym() and dladdr() read (the soinfo lists, namespaces and the handle map)
+// is only modified while holding both g_dl_mutex and g_dl_rwlock for writing, which lets those
+// lookups run concurrently with each other under the read lock. g_dl_write_lock_depth is
+// protected by g_dl_mutex.
+__LIBC_HIDDEN__ extern pthread_rwlock_t g_dl_rwlock;
+__LIBC_HIDDEN__ extern size_t g_dl_write_lock_depth;
+
+// Takes g_dl_rwlock for writing. The caller must hold g_dl_mutex; nested loader calls on the
+// same thread only bump the depth.
+class ScopedDlWriteLock {
+ public:
+  ScopedDlWriteLock() {
+    if (g_dl_write_lock_depth++ == 0) {
+      pthread_rwlock_wrlock(&g_dl_rwlock);
+      dlsym_cache_invalidate();
+    }
+  }
+  ~ScopedDlWriteLock() {
+    if (--g_dl_write_lock_depth == 0) pthread_rwlock_unlock(&g_dl_rwlock);
+  }
+};
+
+// Drops the write lock held by the outermost loader call for the lifetime of this object, so
+// that readers can make progress while dlopen() runs constructors. Nested calls keep the lock,
+// since the outer call may be in the middle of modifying loader state.
+class ScopedDlWriteUnlock {
+ public:
+  ScopedDlWriteUnlock() : dropped_(g_dl_write_lock_depth == 1) {
+    if (dropped_) {
+      g_dl_write_lock_depth = 0;
+      pthread_rwlock_unlock(&g_dl_rwlock);
+    }
+  }
+  ~ScopedDlWriteUnlock() {
+    if (dropped_) {
+      pthread_rwlock_wrlock(&g_dl_rwlock);
+      g_dl_write_lock_depth = 1;
+    }
+  }
+ private:
+  bool dropped_;
+};
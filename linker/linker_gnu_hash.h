@@ -28,10 +28,18 @@
 
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
+#include <type_traits>
 #include <utility>
 
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 #if defined(__arm__) || defined(__aarch64__)
 #define USE_GNU_HASH_NEON 1
 #else
@@ -60,3 +68,81 @@ static inline std::pair<uint32_t, uint32_t> calculate_gnu_hash(const char* name)
   return calculate_gnu_hash_simple(name);
 #endif
 }
+
+// The number of libraries whose GNU Bloom filters are tested together by gnu_bloom_test_batch.
+static constexpr size_t kGnuBloomBatchSize = 4;
+
+// Returns a bitmask with bit i set if (words[i] & masks[i]) == masks[i].
+static inline uint32_t gnu_bloom_match(const uint64_t (&words)[kGnuBloomBatchSize],
+                                       const uint64_t (&masks)[kGnuBloomBatchSize]) {
+#if defined(__aarch64__)
+  const uint64x2_t m0 = vld1q_u64(&masks[0]);
+  const uint64x2_t m1 = vld1q_u64(&masks[2]);
+  const uint64x2_t c0 = vceqq_u64(vandq_u64(vld1q_u64(&words[0]), m0), m0);
+  const uint64x2_t c1 = vceqq_u64(vandq_u64(vld1q_u64(&words[2]), m1), m1);
+  return static_cast<uint32_t>((vgetq_lane_u64(c0, 0) & 1) | (vgetq_lane_u64(c0, 1) & 2) |
+                               (vgetq_lane_u64(c1, 0) & 4) | (vgetq_lane_u64(c1, 1) & 8));
+#elif defined(__SSE4_1__)
+  const __m128i m0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&masks[0]));
+  const __m128i m1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&masks[2]));
+  const __m128i w0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&words[0]));
+  const __m128i w1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&words[2]));
+  const __m128i c0 = _mm_cmpeq_epi64(_mm_and_si128(w0, m0), m0);
+  const __m128i c1 = _mm_cmpeq_epi64(_mm_and_si128(w1, m1), m1);
+  return _mm_movemask_pd(_mm_castsi128_pd(c0)) | (_mm_movemask_pd(_mm_castsi128_pd(c1)) << 2);
+#else
+  uint32_t result = 0;
+  for (size_t i = 0; i < kGnuBloomBatchSize; ++i) {
+    result |= static_cast<uint32_t>((words[i] & masks[i]) == masks[i]) << i;
+  }
+  return result;
+#endif
+}
+
+static inline uint32_t gnu_bloom_match(const uint32_t (&words)[kGnuBloomBatchSize],
+                                       const uint32_t (&masks)[kGnuBloomBatchSize]) {
+#if defined(__ARM_NEON)
+  static const uint32_t kLaneBits[kGnuBloomBatchSize] = { 1, 2, 4, 8 };
+  const uint32x4_t m = vld1q_u32(masks);
+  const uint32x4_t c = vandq_u32(vceqq_u32(vandq_u32(vld1q_u32(words), m), m),
+                                 vld1q_u32(kLaneBits));
+  const uint32x2_t sum = vpadd_u32(vget_low_u32(c), vget_high_u32(c));
+  return vget_lane_u32(vpadd_u32(sum, sum), 0);
+#elif defined(__SSE2__)
+  const __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(masks));
+  const __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words));
+  return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(w, m), m)));
+#else
+  uint32_t result = 0;
+  for (size_t i = 0; i < kGnuBloomBatchSize; ++i) {
+    result |= static_cast<uint32_t>((words[i] & masks[i]) == masks[i]) << i;
+  }
+  return result;
+#endif
+}
+
+// Tests the GNU Bloom filters of up to kGnuBloomBatchSize consecutive libraries for the symbol
+// hash. Bit i of the result is set if libs[i] might define the symbol. All the filter words are
+// loaded before any of them is tested, so the cache misses overlap instead of being taken one
+// library at a time.
+//
+// Lib needs gnu_bloom_filter_, gnu_maskwords_, and gnu_shift2_ members (see SymbolLookupFilter).
+template <typename Lib>
+static inline uint32_t gnu_bloom_test_batch(const Lib* libs, size_t count, uint32_t hash) {
+  using Word = std::remove_cv_t<std::remove_pointer_t<decltype(libs->gnu_bloom_filter_)>>;
+  static_assert(sizeof(Word) == sizeof(uint64_t) || sizeof(Word) == sizeof(uint32_t));
+  using LaneWord = std::conditional_t<sizeof(Word) == sizeof(uint64_t), uint64_t, uint32_t>;
+  constexpr uint32_t kBloomMaskBits = sizeof(Word) * 8;
+
+  // An unused lane has an all-ones mask and a zero word, so it never matches.
+  LaneWord words[kGnuBloomBatchSize] = {};
+  LaneWord masks[kGnuBloomBatchSize] = { ~LaneWord(0), ~LaneWord(0), ~LaneWord(0), ~LaneWord(0) };
+
+  const LaneWord h1_bit = LaneWord(1) << (hash % kBloomMaskBits);
+  for (size_t i = 0; i < count; ++i) {
+    const Lib& lib = libs[i];
+    words[i] = lib.gnu_bloom_filter_[(hash / kBloomMaskBits) & lib.gnu_maskwords_];
+    masks[i] = h1_bit | (LaneWord(1) << ((hash >> lib.gnu_shift2_) % kBloomMaskBits));
+  }
+  return gnu_bloom_match(words, masks);
+}
@@ -26,6 +26,13 @@
  * SUCH DAMAGE.
  */
 
+#include <link.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
 #include <benchmark/benchmark.h>
 
 #include "linker_gnu_hash.h"
@@ -308,4 +315,86 @@ BENCHMARK(BM_gnu_hash_neon);
 
 #endif  // USE_GNU_HASH_NEON
 
+// A synthetic SymbolLookupList: the Bloom filter parameters of each library, laid out like
+// SymbolLookupFilter.
+struct BloomLib {
+  ElfW(Addr)* gnu_bloom_filter_;
+  uint32_t gnu_maskwords_;
+  uint32_t gnu_shift2_;
+};
+
+class BloomLibList {
+ public:
+  BloomLibList(size_t lib_count, size_t syms_per_lib) {
+    constexpr uint32_t kBloomMaskBits = sizeof(ElfW(Addr)) * 8;
+    std::mt19937 rng(lib_count);
+
+    // Size the filters the way lld does: roughly 12 bits per symbol, rounded up to a power of two
+    // words, with a shift2 of 26.
+    size_t maskwords = 1;
+    while (maskwords * kBloomMaskBits < syms_per_lib * 12) maskwords <<= 1;
+
+    for (size_t i = 0; i < lib_count; ++i) {
+      words_.emplace_back(maskwords);
+      BloomLib lib = { words_.back().data(), static_cast<uint32_t>(maskwords - 1), 26 };
+      for (size_t j = 0; j < syms_per_lib; ++j) {
+        char name[32];
+        snprintf(name, sizeof(name), "lib%zu_sym%zu_%u", i, j, static_cast<unsigned>(rng()));
+        const uint32_t hash = calculate_gnu_hash_simple(name).first;
+        ElfW(Addr)& word = lib.gnu_bloom_filter_[(hash / kBloomMaskBits) & lib.gnu_maskwords_];
+        word |= ElfW(Addr)(1) << (hash % kBloomMaskBits);
+        word |= ElfW(Addr)(1) << ((hash >> lib.gnu_shift2_) % kBloomMaskBits);
+      }
+      libs_.push_back(lib);
+    }
+  }
+
+  const std::vector<BloomLib>& libs() const { return libs_; }
+
+ private:
+  std::vector<std::vector<ElfW(Addr)>> words_;
+  std::vector<BloomLib> libs_;
+};
+
+// The sample symbols aren't defined by any of the synthetic libraries, so each lookup probes every
+// Bloom filter in the list, as a lookup of a symbol defined late in a long list would.
+static void BM_gnu_bloom_scalar(benchmark::State& state) {
+  BloomLibList list(state.range(0), 2000);
+  constexpr uint32_t kBloomMaskBits = sizeof(ElfW(Addr)) * 8;
+  for (auto _ : state) {
+    for (const char* sym_name : kSampleSymbolList) {
+      const uint32_t hash = calculate_gnu_hash(sym_name).first;
+      size_t candidates = 0;
+      for (const BloomLib& lib : list.libs()) {
+        const ElfW(Addr) bloom_word =
+            lib.gnu_bloom_filter_[(hash / kBloomMaskBits) & lib.gnu_maskwords_];
+        const uint32_t h1 = hash % kBloomMaskBits;
+        const uint32_t h2 = (hash >> lib.gnu_shift2_) % kBloomMaskBits;
+        candidates += (1 & (bloom_word >> h1) & (bloom_word >> h2));
+      }
+      benchmark::DoNotOptimize(candidates);
+    }
+  }
+}
+
+BENCHMARK(BM_gnu_bloom_scalar)->Arg(16)->Arg(64)->Arg(256);
+
+static void BM_gnu_bloom_batch(benchmark::State& state) {
+  BloomLibList list(state.range(0), 2000);
+  const BloomLib* end = list.libs().data() + list.libs().size();
+  for (auto _ : state) {
+    for (const char* sym_name : kSampleSymbolList) {
+      const uint32_t hash = calculate_gnu_hash(sym_name).first;
+      size_t candidates = 0;
+      for (const BloomLib* batch = list.libs().data(); batch < end; batch += kGnuBloomBatchSize) {
+        const size_t count = std::min<size_t>(end - batch, kGnuBloomBatchSize);
+        candidates += __builtin_popcount(gnu_bloom_test_batch(batch, count, hash));
+      }
+      benchmark::DoNotOptimize(candidates);
+    }
+  }
+}
+
+BENCHMARK(BM_gnu_bloom_batch)->Arg(16)->Arg(64)->Arg(256);
+
 BENCHMARK_MAIN();
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "linker_lazy_bind.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <async_safe/log.h>
+
+#include "linker.h"
+#include "linker_debug.h"
+#include "linker_globals.h"
+#include "linker_relocs.h"
+#include "linker_soinfo.h"
+#include "linker_utils.h"
+
+// The per-architecture entry point the PLT header jumps to through GOT[2].
+__LIBC_HIDDEN__ extern "C" void lazy_bind_trampoline();
+
+static std::vector<std::string> g_lazy_bind_libs;
+
+// Everything the trampoline needs to resolve a slot of one library. GOT[1] points at it.
+struct LazyBinding {
+  soinfo* si;
+  const ElfW(Sym)* symtab;
+  const rel_t* plt_relocs;
+  size_t plt_reloc_count;
+  VersionTracker version_tracker;
+};
+
+static std::unordered_map<const soinfo*, LazyBinding*> g_lazy_bindings;
+
+void set_lazy_bind_libs(const char* libs) {
+  split_path(libs, ":", &g_lazy_bind_libs);
+}
+
+bool lazy_bind_wanted(const soinfo* si __unused) {
+#if defined(__aarch64__) || defined(__x86_64__)
+  if (g_lazy_bind_libs.empty() || si->is_linker() || si->plt_got() == nullptr) return false;
+  if ((si->get_dt_flags_1() & DF_1_NOW) != 0) return false;
+  // The trampoline only preserves the registers of the base procedure call standard.
+  if (si->has_variant_pcs()) {
+    LD_DEBUG(reloc, "[ not binding %s lazily: it has DT_AARCH64_VARIANT_PCS ]",
+             si->get_realpath());
+    return false;
+  }
+
+  const char* realpath = si->get_realpath();
+  const char* name = strrchr(realpath, '/');
+  name = (name == nullptr) ? realpath : name + 1;
+  bool listed = false;
+  for (const auto& lib : g_lazy_bind_libs) {
+    if (lib == name) {
+      listed = true;
+      break;
+    }
+  }
+  if (!listed) return false;
+
+  // The GOT must still be writable once RELRO is protected. Compat mode moves RELRO around, so
+  // don't bother with it.
+  if (si->should_use_16kib_app_compat()) return false;
+  ElfW(Addr) got = reinterpret_cast<ElfW(Addr)>(si->plt_got());
+  for (size_t i = 0; i < si->phnum; ++i) {
+    const ElfW(Phdr)& phdr = si->phdr[i];
+    if (phdr.p_type != PT_GNU_RELRO) continue;
+    ElfW(Addr) start = si->load_bias + phdr.p_vaddr;
+    if (got >= start && got < start + phdr.p_memsz) {
+      LD_DEBUG(reloc, "[ not binding %s lazily: its GOT is read-only after relocation ]",
+               si->get_realpath());
+      return false;
+    }
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool lazy_bind_prepare(soinfo* si, const ElfW(Sym)* symtab, const rel_t* plt_relocs,
+                       size_t plt_reloc_count) {
+  LazyBinding* binding = new LazyBinding;
+  binding->si = si;
+  binding->symtab = symtab;
+  binding->plt_relocs = plt_relocs;
+  binding->plt_reloc_count = plt_reloc_count;
+  if (!binding->version_tracker.init(si)) {
+    delete binding;
+    return false;
+  }
+  g_lazy_bindings[si] = binding;
+
+  // GOT[0] is left alone: it's the link-time address of the dynamic section.
+  ElfW(Addr)* got = si->plt_got();
+  got[1] = reinterpret_cast<ElfW(Addr)>(binding);
+  got[2] = reinterpret_cast<ElfW(Addr)>(&lazy_bind_trampoline);
+  LD_DEBUG(reloc, "[ binding %zu plt relocations of %s lazily ]", plt_reloc_count,
+           si->get_realpath());
+  return true;
+}
+
+void lazy_bind_forget(soinfo* si) {
+  auto it = g_lazy_bindings.find(si);
+  if (it == g_lazy_bindings.end()) return;
+  delete it->second;
+  g_lazy_bindings.erase(it);
+}
+
+// Resolves and fills in the slot of `binding`'s `index`th PLT relocation, returning its new
+// value. Holding g_dl_rwlock for reading only protects the loaded libraries from changing under
+// us, so this must not allocate or report errors through DL_ERR until it has g_dl_mutex.
+static ElfW(Addr) lazy_bind_resolve(LazyBinding* binding, size_t index, bool* read_locked) {
+  soinfo* si = binding->si;
+  if (index >= binding->plt_reloc_count) {
+    async_safe_fatal("invalid lazy binding index %zu for \"%s\"", index, si->get_realpath());
+  }
+  const rel_t& reloc = binding->plt_relocs[index];
+  if (ELFW(R_TYPE)(reloc.r_info) != R_GENERIC_JUMP_SLOT) {
+    async_safe_fatal("lazy binding index %zu for \"%s\" is not a JUMP_SLOT relocation", index,
+                     si->get_realpath());
+  }
+
+  ElfW(Word) sym_index = ELFW(R_SYM)(reloc.r_info);
+  const ElfW(Sym)* ref = &binding->symtab[sym_index];
+  const char* name = si->get_string(ref->st_name);
+
+  const version_info* vi = nullptr;
+  const ElfW(Versym)* versym = si->get_versym(sym_index);
+  if (versym != nullptr && *versym != VER_NDX_LOCAL && *versym != VER_NDX_GLOBAL) {
+    vi = binding->version_tracker.get_version_info(*versym);
+    if (vi == nullptr) {
+      async_safe_fatal("cannot find verneed/verdef for version index=%d referenced by symbol "
+                       "\"%s\" at \"%s\"", *versym, name, si->get_realpath());
+    }
+  }
+
+  soinfo* found = nullptr;
+  const ElfW(Sym)* sym = nullptr;
+  if (!lazy_bind_lookup(si, name, vi, true, &found, &sym)) {
+    // The dependency tree is too large to walk without allocating.
+    if (*read_locked) {
+      pthread_rwlock_unlock(&g_dl_rwlock);
+      *read_locked = false;
+    }
+    ScopedDlMutexLock locker;
+    lazy_bind_lookup(si, name, vi, false, &found, &sym);
+  }
+
+  ElfW(Addr) value = 0;
+  if (sym != nullptr) {
+    value = found->resolve_symbol_address(sym);
+  } else if (ELF_ST_BIND(ref->st_info) != STB_WEAK) {
+    async_safe_fatal("cannot locate symbol \"%s\" referenced by \"%s\" (bound lazily)", name,
+                     si->get_realpath());
+  }
+  LD_DEBUG(reloc, "[ lazily bound %s in %s to %p (%s) ]", name, si->get_realpath(),
+           reinterpret_cast<void*>(value), found != nullptr ? found->get_realpath() : "weak");
+
+  ElfW(Addr)* slot = reinterpret_cast<ElfW(Addr)*>(reloc.r_offset + si->load_bias);
+  __atomic_store_n(slot, value, __ATOMIC_RELAXED);
+  return value;
+}
+
+// Called by lazy_bind_trampoline with the GOT[1] value and the index of the PLT relocation to
+// resolve. Returns the function the trampoline should continue into.
+__LIBC_HIDDEN__ extern "C" ElfW(Addr) lazy_bind_fixup(LazyBinding* binding, size_t index) {
+  // The read lock fails with EDEADLK if this thread is in the middle of a dlopen() or dlclose()
+  // itself (an ifunc resolver or a constructor calling through the PLT), in which case it already
+  // has exclusive access.
+  bool read_locked = pthread_rwlock_rdlock(&g_dl_rwlock) == 0;
+  ElfW(Addr) result = lazy_bind_resolve(binding, index, &read_locked);
+  if (read_locked) pthread_rwlock_unlock(&g_dl_rwlock);
+  return result;
+}
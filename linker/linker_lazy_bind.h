@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <link.h>
+#include <stddef.h>
+
+#include "linker_reloc_iterators.h"
+
+struct soinfo;
+
+// Lazy binding of PLT entries.
+//
+// LD_BIND_LAZY=libfoo.so:libbar.so asks the linker not to resolve the JUMP_SLOT relocations of
+// the listed libraries (matched by file name) up front. Each GOT slot is instead left pointing
+// back into the library's PLT, whose header calls the linker's per-architecture trampoline with
+// the slot being resolved. The trampoline looks the symbol up in the scope the library was
+// linked with, stores the definition in the slot so later calls go straight to it, and tail
+// calls it. Libraries that import a lot but only call a little of it don't pay for the lookups
+// they never need at startup.
+//
+// Only arm64 and x86_64 have trampolines. The library's GOT must also stay writable, which rules
+// out libraries linked with -z now (their GOT is part of PT_GNU_RELRO). Every other library is
+// bound eagerly as usual, as are arm64 libraries with DT_AARCH64_VARIANT_PCS. A symbol that
+// can't be found aborts the process on the first call instead of failing dlopen().
+
+#if !defined(STO_AARCH64_VARIANT_PCS)
+#define STO_AARCH64_VARIANT_PCS 0x80
+#endif
+
+// True if calls to `sym` use a variant procedure call standard, which a lazy binding trampoline
+// doesn't preserve.
+static inline bool is_variant_pcs_symbol(const ElfW(Sym)& sym __unused) {
+#if defined(__aarch64__)
+  return (sym.st_other & STO_AARCH64_VARIANT_PCS) != 0;
+#else
+  return false;
+#endif
+}
+
+// Sets the colon-separated list of library file names to bind lazily.
+void set_lazy_bind_libs(const char* libs);
+
+// Returns true if `si`'s JUMP_SLOT relocations should be bound lazily.
+bool lazy_bind_wanted(const soinfo* si);
+
+// Sets up `si`'s GOT for lazy binding of the JUMP_SLOT relocations in `plt_relocs`, which refer
+// to `symtab`. The caller is responsible for pointing each slot back at its PLT entry. Returns
+// false on failure.
+bool lazy_bind_prepare(soinfo* si, const ElfW(Sym)* symtab, const rel_t* plt_relocs,
+                       size_t plt_reloc_count);
+
+// Called when `si` is freed.
+void lazy_bind_forget(soinfo* si);
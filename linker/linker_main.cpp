@@ -36,11 +36,14 @@
 #include "linker.h"
 #include "linker_auxv.h"
 #include "linker_cfi.h"
+#include "linker_config.h"
 #include "linker_debug.h"
 #include "linker_debuggerd.h"
 #include "linker_gdb_support.h"
 #include "linker_globals.h"
+#include "linker_lazy_bind.h"
 #include "linker_phdr.h"
+#include "linker_reloc_cache.h"
 #include "linker_relocate.h"
 #include "linker_relocs.h"
 #include "linker_tls.h"
@@ -179,6 +182,7 @@ static void add_vdso() {
   vdso->phnum = ehdr_vdso->e_phnum;
   vdso->base = reinterpret_cast<ElfW(Addr)>(ehdr_vdso);
   vdso->size = phdr_table_get_load_size(vdso->phdr, vdso->phnum);
+  soinfo_address_index_add(vdso);
   vdso->load_bias = get_elf_exec_load_bias(ehdr_vdso);
 
   if (!vdso->prelink_image() || !vdso->link_image(SymbolLookupList(vdso), vdso, nullptr, nullptr)) {
@@ -321,6 +325,36 @@ static ElfW(Addr) linker_main(KernelArgumentBlock& args, const char* exe_to_load
     if (ldpreload_env != nullptr) {
       LD_DEBUG(any, "[ LD_PRELOAD set to \"%s\" ]", ldpreload_env);
     }
+    if (getenv("LD_PREFETCH_DEPENDENCIES") != nullptr) {
+      LD_DEBUG(any, "[ LD_PREFETCH_DEPENDENCIES set ]");
+      set_prefetch_dependencies_mode(true);
+    }
+    const char* prefault_segments = getenv("LD_PREFAULT_SEGMENTS");
+    if (prefault_segments != nullptr) {
+      LD_DEBUG(any, "[ LD_PREFAULT_SEGMENTS set to \"%s\" ]", prefault_segments);
+      if (strcmp(prefault_segments, "willneed") == 0) {
+        set_segment_prefault_mode(SegmentPrefaultMode::kWillNeed);
+      } else if (strcmp(prefault_segments, "populate") == 0) {
+        set_segment_prefault_mode(SegmentPrefaultMode::kPopulate);
+      } else {
+        DL_WARN("ignoring unknown LD_PREFAULT_SEGMENTS value \"%s\" "
+                "(expected \"willneed\" or \"populate\")", prefault_segments);
+      }
+    }
+    const char* bind_lazy = getenv("LD_BIND_LAZY");
+    if (bind_lazy != nullptr) {
+      LD_DEBUG(any, "[ LD_BIND_LAZY set to \"%s\" ]", bind_lazy);
+      set_lazy_bind_libs(bind_lazy);
+    }
+    if (getenv("LD_CONFIG_WRITE_COMPILED") != nullptr) {
+      LD_DEBUG(any, "[ LD_CONFIG_WRITE_COMPILED set ]");
+      Config::set_write_compiled_config_on_parse(true);
+    }
+    const char* reloc_cache_dir = getenv("LD_RELOC_CACHE_DIR");
+    if (reloc_cache_dir != nullptr) {
+      LD_DEBUG(any, "[ LD_RELOC_CACHE_DIR set to \"%s\" ]", reloc_cache_dir);
+      set_reloc_cache_dir(reloc_cache_dir);
+    }
   }
 
   const ExecutableInfo exe_info = exe_to_load ? load_executable(exe_to_load) :
@@ -338,6 +372,7 @@ static ElfW(Addr) linker_main(KernelArgumentBlock& args, const char* exe_to_load
   si->set_should_pad_segments(exe_info.should_pad_segments);
   get_elf_base_from_phdr(si->phdr, si->phnum, &si->base, &si->load_bias);
   si->size = phdr_table_get_load_size(si->phdr, si->phnum);
+  soinfo_address_index_add(si);
   si->dynamic = nullptr;
   si->set_main_executable();
   init_link_map_head(*si);
@@ -704,7 +739,14 @@ extern "C" ElfW(Addr) __linker_init(void* raw_args) {
   // entry point. This must happen after destructors are called in this function
   // (e.g. ~soinfo), so declare this variable very early.
   struct DlMutexUnlocker {
-    ~DlMutexUnlocker() { pthread_mutex_unlock(&g_dl_mutex); }
+    ~DlMutexUnlocker() {
+      if (g_dl_write_lock_depth != 0) {
+        g_dl_write_lock_depth = 0;
+        pthread_rwlock_unlock(&g_dl_rwlock);
+      }
+      g_dl_mutex_depth = 0;
+      pthread_mutex_unlock(&g_dl_mutex);
+    }
   } unlocker;
 
   // Initialize TLS early so system calls and errno work.
@@ -776,8 +818,12 @@ __linker_init_post_relocation(KernelArgumentBlock& args, soinfo& tmp_linker_so)
 
   // A constructor could spawn a thread that calls into the loader, so as soon
   // as we've called a constructor, we need to hold the lock until transferring
-  // to the entry point.
+  // to the entry point. That includes the write lock, which keeps dlsym() and
+  // dladdr() out until the executable's constructors have all run.
   pthread_mutex_lock(&g_dl_mutex);
+  g_dl_mutex_depth = 1;
+  pthread_rwlock_wrlock(&g_dl_rwlock);
+  g_dl_write_lock_depth = 1;
 
   // Initialize the linker's own global variables
   tmp_linker_so.call_constructors();
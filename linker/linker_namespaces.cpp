@@ -32,6 +32,53 @@
 #include "linker_utils.h"
 
 #include <dlfcn.h>
+#include <stdint.h>
+
+#include <atomic>
+
+// is_accessible(soinfo*) runs for every candidate library in dlsym(), symbol binding and
+// find_loaded_library_by_soname(), and for a library that isn't directly in the namespace it
+// walks all of the library's parents. The decisions are memoized in a small direct-mapped table
+// per namespace.
+//
+// Lookups may hold g_dl_rwlock only for reading, concurrently with each other, and namespace
+// memory is read-only outside ProtectedDataGuard. So the tables live in the linker's own .bss
+// and every entry is a single atomic word: the soinfo pointer, with the decision in bit 0 and
+// bit 1 set to mark the entry as used. Anything that can change a decision bumps
+// g_access_cache_generation under the write lock; the first lookup to notice clears the table.
+static constexpr size_t kAccessCacheNamespaces = 32;
+static constexpr size_t kAccessCacheEntries = 64;
+static constexpr size_t kNoAccessCache = SIZE_MAX;
+
+static constexpr uintptr_t kAccessCacheAccessible = 1;
+static constexpr uintptr_t kAccessCacheUsed = 2;
+
+struct AccessCache {
+  std::atomic<uint64_t> generation;
+  std::atomic<uintptr_t> entries[kAccessCacheEntries];
+};
+
+static AccessCache g_access_caches[kAccessCacheNamespaces];
+static std::atomic<uint64_t> g_access_cache_generation = 1;
+static size_t g_access_caches_used = 0;
+
+void invalidate_namespace_access_cache() {
+  g_access_cache_generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+static size_t access_cache_slot(const soinfo* si) {
+  // soinfos are at least 8-byte aligned; fold in higher bits to spread allocator strides.
+  uintptr_t key = reinterpret_cast<uintptr_t>(si) >> 3;
+  return (key ^ (key >> 7)) % kAccessCacheEntries;
+}
+
+android_namespace_t::android_namespace_t() :
+  is_isolated_(false),
+  is_exempt_list_enabled_(false),
+  is_also_used_as_anonymous_(false),
+  concurrent_constructors_(false),
+  access_cache_index_(g_access_caches_used < kAccessCacheNamespaces ? g_access_caches_used++
+                                                                    : kNoAccessCache) {}
 
 // Given an absolute path, can this library be loaded into this namespace?
 bool android_namespace_t::is_accessible(const std::string& file) {
@@ -70,6 +117,36 @@ bool android_namespace_t::is_accessible(const std::string& file) {
 // Are symbols from this shared object accessible for symbol lookups in a library from this
 // namespace?
 bool android_namespace_t::is_accessible(soinfo* s) {
+  // Don't remember anything about soinfos of unknown layout (see below); they get a warning
+  // every time.
+  if (access_cache_index_ == kNoAccessCache || !s->is_lp64_or_has_min_version(3)) {
+    return is_accessible_uncached(s);
+  }
+
+  AccessCache& cache = g_access_caches[access_cache_index_];
+  uint64_t generation = g_access_cache_generation.load(std::memory_order_relaxed);
+  if (cache.generation.load(std::memory_order_acquire) != generation) {
+    for (auto& entry : cache.entries) {
+      entry.store(0, std::memory_order_relaxed);
+    }
+    cache.generation.store(generation, std::memory_order_release);
+  }
+
+  std::atomic<uintptr_t>& entry = cache.entries[access_cache_slot(s)];
+  uintptr_t cached = entry.load(std::memory_order_relaxed);
+  if ((cached & ~(kAccessCacheAccessible | kAccessCacheUsed)) == reinterpret_cast<uintptr_t>(s) &&
+      (cached & kAccessCacheUsed) != 0) {
+    return (cached & kAccessCacheAccessible) != 0;
+  }
+
+  bool accessible = is_accessible_uncached(s);
+  entry.store(reinterpret_cast<uintptr_t>(s) | kAccessCacheUsed |
+              (accessible ? kAccessCacheAccessible : 0),
+              std::memory_order_relaxed);
+  return accessible;
+}
+
+bool android_namespace_t::is_accessible_uncached(soinfo* s) {
   auto is_accessible_ftor = [this] (soinfo* si, bool allow_secondary) {
     // This is workaround for apps hacking into soinfo list.
     // and inserting their own entries into it. (http://b/37191433)
@@ -36,6 +36,11 @@
 
 std::vector<std::string> fix_lib_paths(std::vector<std::string> paths);
 
+// Discards every memoized android_namespace_t::is_accessible(soinfo*) decision. Must be called,
+// with g_dl_rwlock held for writing, whenever a soinfo's parents, primary namespace or secondary
+// namespaces change.
+void invalidate_namespace_access_cache();
+
 struct android_namespace_t;
 
 struct android_namespace_link_t {
@@ -71,10 +76,7 @@ struct android_namespace_link_t {
 
 struct android_namespace_t {
  public:
-  android_namespace_t() :
-    is_isolated_(false),
-    is_exempt_list_enabled_(false),
-    is_also_used_as_anonymous_(false) {}
+  android_namespace_t();
 
   const char* get_name() const { return name_.c_str(); }
   void set_name(const char* name) { name_ = name; }
@@ -88,6 +90,11 @@ struct android_namespace_t {
   bool is_also_used_as_anonymous() const { return is_also_used_as_anonymous_; }
   void set_also_used_as_anonymous(bool yes) { is_also_used_as_anonymous_ = yes; }
 
+  // Whether dlopen() of a library in this namespace may release g_dl_mutex while running
+  // constructors, so that other threads' dlopen() calls can run theirs at the same time.
+  bool has_concurrent_constructors() const { return concurrent_constructors_; }
+  void set_concurrent_constructors(bool yes) { concurrent_constructors_ = yes; }
+
   const std::vector<std::string>& get_ld_library_paths() const {
     return ld_library_paths_;
   }
@@ -123,6 +130,17 @@ struct android_namespace_t {
     allowed_libs_ = allowed_libs;
   }
 
+  // Libraries (by file name) whose RELRO segments are shared with other processes through
+  // files in get_shared_relro_dir(); see linker_shared_relro.h.
+  const std::vector<std::string>& get_shared_relro_libs() const { return shared_relro_libs_; }
+  void set_shared_relro_libs(const std::vector<std::string>& shared_relro_libs) {
+    shared_relro_libs_ = shared_relro_libs;
+  }
+  const std::string& get_shared_relro_dir() const { return shared_relro_dir_; }
+  void set_shared_relro_dir(const std::string& shared_relro_dir) {
+    shared_relro_dir_ = shared_relro_dir;
+  }
+
   const std::vector<android_namespace_link_t>& linked_namespaces() const {
     return linked_namespaces_;
   }
@@ -158,20 +176,28 @@ struct android_namespace_t {
   // Returns true if si is accessible from this namespace. A soinfo
   // is considered accessible when it belongs to this namespace
   // or one of it's parent soinfos belongs to this namespace.
+  // The answer is memoized; see invalidate_namespace_access_cache().
   bool is_accessible(soinfo* si);
 
   soinfo_list_t get_global_group();
   soinfo_list_t get_shared_group();
 
  private:
+  bool is_accessible_uncached(soinfo* si);
+
   std::string name_;
   bool is_isolated_;
   bool is_exempt_list_enabled_;
   bool is_also_used_as_anonymous_;
+  bool concurrent_constructors_;
+  // Index into the access decision cache, or kNoAccessCache.
+  size_t access_cache_index_;
   std::vector<std::string> ld_library_paths_;
   std::vector<std::string> default_library_paths_;
   std::vector<std::string> permitted_paths_;
   std::vector<std::string> allowed_libs_;
+  std::vector<std::string> shared_relro_libs_;
+  std::string shared_relro_dir_;
   // Loader looks into linked namespace if it was not able
   // to find a library in this namespace. Note that library
   // lookup in linked namespaces are limited by the list of
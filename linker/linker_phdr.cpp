@@ -29,6 +29,7 @@
 #include "linker_phdr.h"
 
 #include <errno.h>
+#include <fcntl.h>
 #include <string.h>
 #include <sys/mman.h>
 #include <sys/prctl.h>
@@ -36,6 +37,8 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
+
 #include "linker.h"
 #include "linker_debug.h"
 #include "linker_dlwarning.h"
@@ -194,6 +197,70 @@ bool ElfReader::Read(const char* name, int fd, off64_t file_offset, off64_t file
   return did_read_;
 }
 
+void ElfReader::PrefetchSegments() const {
+  CHECK(did_read_);
+  for (size_t i = 0; i < phdr_num_; ++i) {
+    const ElfW(Phdr)* phdr = &phdr_table_[i];
+    if (phdr->p_type != PT_LOAD || phdr->p_filesz == 0) {
+      continue;
+    }
+    const off64_t start = page_start(file_offset_ + phdr->p_offset);
+    const off64_t end = page_end(file_offset_ + phdr->p_offset + phdr->p_filesz);
+    int err = posix_fadvise64(fd_, start, end - start, POSIX_FADV_WILLNEED);
+    if (err != 0) {
+      // This is only a hint; loading works the same without it.
+      LD_DEBUG(any, "[ readahead of \"%s\" segment %zu failed: %s ]", name_.c_str(), i,
+               strerror(err));
+      return;
+    }
+  }
+}
+
+static SegmentPrefaultMode g_segment_prefault_mode = SegmentPrefaultMode::kNone;
+
+void set_segment_prefault_mode(SegmentPrefaultMode mode) {
+  g_segment_prefault_mode = mode;
+}
+
+static void prefault_range(const char* name, ElfW(Addr) start, ElfW(Addr) end,
+                           int populate_advice) {
+  void* addr = reinterpret_cast<void*>(start);
+  size_t len = end - start;
+  if (g_segment_prefault_mode == SegmentPrefaultMode::kPopulate) {
+    if (madvise(addr, len, populate_advice) == 0) {
+      return;
+    }
+    // Kernels before 5.14 don't have MADV_POPULATE_*, so fall back to readahead.
+    if (errno != EINVAL) {
+      LD_DEBUG(any, "[ populating %p-%p of \"%s\" failed: %m ]", addr,
+               reinterpret_cast<void*>(end), name);
+      return;
+    }
+  }
+  if (madvise(addr, len, MADV_WILLNEED) == -1) {
+    LD_DEBUG(any, "[ readahead of %p-%p of \"%s\" failed: %m ]", addr,
+             reinterpret_cast<void*>(end), name);
+  }
+}
+
+void ElfReader::PrefaultSegments() const {
+  // In 16KiB app compat mode the segments are read into anonymous memory, so there is nothing
+  // left to fault in.
+  if (g_segment_prefault_mode == SegmentPrefaultMode::kNone || should_use_16kib_app_compat_) {
+    return;
+  }
+  for (size_t i = 0; i < phdr_num_; ++i) {
+    const ElfW(Phdr)* phdr = &phdr_table_[i];
+    if (phdr->p_type == PT_LOAD && (phdr->p_flags & PF_X) != 0 && phdr->p_filesz != 0) {
+      prefault_range(name_.c_str(), page_start(phdr->p_vaddr) + load_bias_,
+                     page_end(phdr->p_vaddr + phdr->p_filesz) + load_bias_, MADV_POPULATE_READ);
+    } else if (phdr->p_type == PT_GNU_RELRO && phdr->p_memsz != 0) {
+      prefault_range(name_.c_str(), page_start(phdr->p_vaddr) + load_bias_,
+                     page_end(phdr->p_vaddr + phdr->p_memsz) + load_bias_, MADV_POPULATE_WRITE);
+    }
+  }
+}
+
 bool ElfReader::Load(address_space_params* address_space) {
   CHECK(did_read_);
   if (did_load_) {
@@ -211,6 +278,9 @@ bool ElfReader::Load(address_space_params* address_space) {
                                        should_use_16kib_app_compat_, &note_gnu_property_) == 0);
     }
 #endif
+    if (did_load_) {
+      PrefaultSegments();
+    }
   }
   if (reserveSuccess && !did_load_) {
     if (load_start_ != nullptr && load_size_ != 0) {
@@ -341,6 +411,54 @@ bool ElfReader::CheckFileRange(ElfW(Addr) offset, size_t size, size_t alignment)
          ((offset % alignment) == 0);
 }
 
+#if defined(__LP64__)
+static constexpr off64_t kMaxFileFragmentSize = INT64_MAX;
+#else
+// Mapping whole libraries while their dependencies are being read could use up a lot of a 32-bit
+// address space, so larger files are mapped a fragment at a time.
+static constexpr off64_t kMaxFileFragmentSize = 8 * 1024 * 1024;
+#endif
+
+// Returns the end of the ELF file's headers, as far as the ELF header tells. Linkers put the
+// section header table last, so this is normally the end of the ELF file even when it is followed
+// by something else (the rest of an APK, say).
+static off64_t elf_header_extent(const ElfW(Ehdr)& header) {
+  uint64_t phdr_end;
+  uint64_t shdr_end;
+  if (__builtin_add_overflow(header.e_phoff, header.e_phnum * sizeof(ElfW(Phdr)), &phdr_end) ||
+      __builtin_add_overflow(header.e_shoff, header.e_shnum * sizeof(ElfW(Shdr)), &shdr_end)) {
+    return INT64_MAX;
+  }
+  uint64_t end = std::max<uint64_t>({ sizeof(header), phdr_end, shdr_end });
+  return end > INT64_MAX ? INT64_MAX : static_cast<off64_t>(end);
+}
+
+// Returns a read-only view of `size` bytes at `offset` in the ELF file, which must already have
+// been checked with CheckFileRange(). Views share a single mapping of the ELF file when possible,
+// and otherwise map `fragment`.
+const void* ElfReader::MapFileRange(MappedFileFragment* fragment, ElfW(Addr) offset, size_t size) {
+  if (!tried_file_fragment_) {
+    tried_file_fragment_ = true;
+    off64_t file_fragment_size =
+        std::min(file_size_ - file_offset_, elf_header_extent(header_));
+    if (file_fragment_size > 0 && file_fragment_size <= kMaxFileFragmentSize &&
+        !file_fragment_.Map(fd_, file_offset_, 0, file_fragment_size)) {
+      LD_DEBUG(any, "[ mapping all of \"%s\" failed: %m; mapping its headers separately ]",
+               name_.c_str());
+    }
+  }
+
+  // Anything past the section header table gets a mapping of its own.
+  if (file_fragment_.data() != nullptr && offset <= file_fragment_.size() &&
+      size <= file_fragment_.size() - offset) {
+    return static_cast<const char*>(file_fragment_.data()) + offset;
+  }
+  if (!fragment->Map(fd_, file_offset_, offset, size)) {
+    return nullptr;
+  }
+  return fragment->data();
+}
+
 // Loads the program header table from an ELF file into a read-only private
 // anonymous mmap-ed block.
 bool ElfReader::ReadProgramHeaders() {
@@ -363,12 +481,13 @@ bool ElfReader::ReadProgramHeaders() {
     return false;
   }
 
-  if (!phdr_fragment_.Map(fd_, file_offset_, header_.e_phoff, size)) {
+  phdr_table_ =
+      static_cast<const ElfW(Phdr)*>(MapFileRange(&phdr_fragment_, header_.e_phoff, size));
+  if (phdr_table_ == nullptr) {
     DL_ERR("\"%s\" phdr mmap failed: %m", name_.c_str());
     return false;
   }
 
-  phdr_table_ = static_cast<ElfW(Phdr)*>(phdr_fragment_.data());
   return true;
 }
 
@@ -389,12 +508,13 @@ bool ElfReader::ReadSectionHeaders() {
     return false;
   }
 
-  if (!shdr_fragment_.Map(fd_, file_offset_, header_.e_shoff, size)) {
+  shdr_table_ =
+      static_cast<const ElfW(Shdr)*>(MapFileRange(&shdr_fragment_, header_.e_shoff, size));
+  if (shdr_table_ == nullptr) {
     DL_ERR("\"%s\" shdr mmap failed: %m", name_.c_str());
     return false;
   }
 
-  shdr_table_ = static_cast<const ElfW(Shdr)*>(shdr_fragment_.data());
   return true;
 }
 
@@ -466,26 +586,26 @@ bool ElfReader::ReadDynamicSection() {
     return false;
   }
 
-  if (!dynamic_fragment_.Map(fd_, file_offset_, dynamic_shdr->sh_offset, dynamic_shdr->sh_size)) {
+  dynamic_ = static_cast<const ElfW(Dyn)*>(
+      MapFileRange(&dynamic_fragment_, dynamic_shdr->sh_offset, dynamic_shdr->sh_size));
+  if (dynamic_ == nullptr) {
     DL_ERR("\"%s\" dynamic section mmap failed: %m", name_.c_str());
     return false;
   }
 
-  dynamic_ = static_cast<const ElfW(Dyn)*>(dynamic_fragment_.data());
-
   if (!CheckFileRange(strtab_shdr->sh_offset, strtab_shdr->sh_size, alignof(const char))) {
     DL_ERR_AND_LOG("\"%s\" has invalid offset/size of the .strtab section linked from .dynamic section",
                    name_.c_str());
     return false;
   }
 
-  if (!strtab_fragment_.Map(fd_, file_offset_, strtab_shdr->sh_offset, strtab_shdr->sh_size)) {
+  strtab_ = static_cast<const char*>(
+      MapFileRange(&strtab_fragment_, strtab_shdr->sh_offset, strtab_shdr->sh_size));
+  if (strtab_ == nullptr) {
     DL_ERR("\"%s\" strtab section mmap failed: %m", name_.c_str());
     return false;
   }
-
-  strtab_ = static_cast<const char*>(strtab_fragment_.data());
-  strtab_size_ = strtab_fragment_.size();
+  strtab_size_ = strtab_shdr->sh_size;
   return true;
 }
 
@@ -646,6 +766,32 @@ static void* ReserveWithAlignmentPadding(size_t size, size_t mapping_align, size
   return start;
 }
 
+// Returns true if the file-backed part of the given segment could be backed by transparent
+// huge pages once mapped at a PMD-aligned load bias: it must be executable, its p_align must
+// keep p_vaddr and p_offset congruent modulo the PMD size (which also requires the library to
+// start at a PMD-aligned offset in its file or zip), and it must cover at least one whole
+// PMD-aligned range. Smaller segments gain nothing from the alignment.
+bool ElfReader::IsHugePageEligible(const ElfW(Phdr)* phdr) const {
+  if (phdr->p_type != PT_LOAD || (phdr->p_flags & PF_X) == 0 || phdr->p_align < kPmdSize) {
+    return false;
+  }
+  if (should_use_16kib_app_compat_ || (file_offset_ % kPmdSize) != 0) {
+    return false;
+  }
+  ElfW(Addr) first_huge_page = __builtin_align_up(phdr->p_vaddr, kPmdSize);
+  ElfW(Addr) last_huge_page_end = __builtin_align_down(phdr->p_vaddr + phdr->p_filesz, kPmdSize);
+  return first_huge_page < last_huge_page_end;
+}
+
+bool ElfReader::HasHugePageEligibleSegment() const {
+  for (size_t i = 0; i < phdr_num_; ++i) {
+    if (IsHugePageEligible(&phdr_table_[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+
 // Reserve a virtual address range big enough to hold all loadable
 // segments of a program header table. This is done by creating a
 // private anonymous mmap() with PROT_NONE.
@@ -676,8 +822,9 @@ bool ElfReader::ReserveAddressSpace(address_space_params* address_space) {
     size_t start_alignment = page_size();
     if (get_transparent_hugepages_supported() && get_application_target_sdk_version() >= 31) {
       // Limit alignment to PMD size as other alignments reduce the number of
-      // bits available for ASLR for no benefit.
-      start_alignment = max_align_ == kPmdSize ? kPmdSize : page_size();
+      // bits available for ASLR for no benefit. Only give up those bits for
+      // libraries that have text large enough to be backed by a huge page.
+      start_alignment = HasHugePageEligibleSegment() ? kPmdSize : page_size();
     }
     start = ReserveWithAlignmentPadding(load_size_, kLibraryAlignment, start_alignment, &gap_start_,
                                         &gap_size_);
@@ -769,7 +916,8 @@ bool ElfReader::ReadPadSegmentNote() {
     // We scope note_fragment to within the loop so that there is
     // at most one PT_NOTE mapped at any time.
     MappedFileFragment note_fragment;
-    if (!note_fragment.Map(fd_, file_offset_, phdr->p_offset, phdr->p_filesz)) {
+    const void* note_data = MapFileRange(&note_fragment, phdr->p_offset, phdr->p_filesz);
+    if (note_data == nullptr) {
       DL_ERR("\"%s\": PT_NOTE mmap(nullptr, %p, PROT_READ, MAP_PRIVATE, %d, %p) failed: %m",
              name_.c_str(), reinterpret_cast<void*>(phdr->p_filesz), fd_,
              reinterpret_cast<void*>(page_start(file_offset_ + phdr->p_offset)));
@@ -779,7 +927,7 @@ bool ElfReader::ReadPadSegmentNote() {
     const ElfW(Nhdr)* note_hdr = nullptr;
     const char* note_desc = nullptr;
     if (!__get_elf_note(NT_ANDROID_TYPE_PAD_SEGMENT, "Android",
-                        reinterpret_cast<ElfW(Addr)>(note_fragment.data()),
+                        reinterpret_cast<ElfW(Addr)>(note_data),
                         phdr, &note_hdr, &note_desc)) {
       continue;
     }
@@ -867,9 +1015,11 @@ bool ElfReader::MapSegment(size_t seg_idx, size_t len) {
     return false;
   }
 
-  // Mark segments as huge page eligible if they meet the requirements
-  if ((phdr->p_flags & PF_X) && phdr->p_align == kPmdSize &&
-      get_transparent_hugepages_supported()) {
+  // Mark segments as huge page eligible if they meet the requirements. The segment's
+  // PMD-aligned interior can only be backed by huge pages if the library itself was
+  // reserved at a PMD-aligned address (see ReserveAddressSpace).
+  if (get_transparent_hugepages_supported() && IsHugePageEligible(phdr) &&
+      (load_bias_ % kPmdSize) == 0) {
     madvise(seg_addr, len, MADV_HUGEPAGE);
   }
 
@@ -48,6 +48,20 @@
 
 static constexpr size_t kCompatPageSize = 0x1000;
 
+// How hard to fault in the hot parts of a library (its executable segments and its RELRO
+// region) right after mapping them, instead of taking a page fault on each first touch.
+enum class SegmentPrefaultMode {
+  // Fault pages in lazily.
+  kNone,
+  // Start asynchronous readahead of the pages (MADV_WILLNEED): avoids major faults.
+  kWillNeed,
+  // Populate the page tables up front (MADV_POPULATE_READ for text, MADV_POPULATE_WRITE for
+  // RELRO, which relocation is about to write): avoids minor faults as well.
+  kPopulate,
+};
+
+void set_segment_prefault_mode(SegmentPrefaultMode mode);
+
 class ElfReader {
  public:
   ElfReader();
@@ -55,6 +69,14 @@ class ElfReader {
   [[nodiscard]] bool Read(const char* name, int fd, off64_t file_offset, off64_t file_size);
   [[nodiscard]] bool Load(address_space_params* address_space);
 
+  // Starts asynchronous readahead of the file ranges backing the PT_LOAD segments. This lets the
+  // kernel fetch the segments of many libraries concurrently while the linker carries on
+  // resolving, reading and mapping the rest of the dependency graph serially.
+  void PrefetchSegments() const;
+
+  // Applies the SegmentPrefaultMode to the mapped segments.
+  void PrefaultSegments() const;
+
   const char* name() const { return name_.c_str(); }
   size_t phdr_count() const { return phdr_num_; }
   ElfW(Addr) load_start() const { return reinterpret_cast<ElfW(Addr)>(load_start_); }
@@ -81,6 +103,8 @@ class ElfReader {
   [[nodiscard]] bool ReadDynamicSection();
   [[nodiscard]] bool ReadPadSegmentNote();
   [[nodiscard]] bool ReserveAddressSpace(address_space_params* address_space);
+  [[nodiscard]] bool IsHugePageEligible(const ElfW(Phdr)* phdr) const;
+  [[nodiscard]] bool HasHugePageEligibleSegment() const;
   [[nodiscard]] bool MapSegment(size_t seg_idx, size_t len);
   [[nodiscard]] bool CompatMapSegment(size_t seg_idx, size_t len);
   void ZeroFillSegment(const ElfW(Phdr)* phdr);
@@ -95,6 +119,8 @@ class ElfReader {
   [[nodiscard]] bool FindGnuPropertySection();
   [[nodiscard]] bool CheckPhdr(ElfW(Addr));
   [[nodiscard]] bool CheckFileRange(ElfW(Addr) offset, size_t size, size_t alignment);
+  [[nodiscard]] const void* MapFileRange(MappedFileFragment* fragment, ElfW(Addr) offset,
+                                         size_t size);
 
   bool did_read_;
   bool did_load_;
@@ -106,6 +132,12 @@ class ElfReader {
   ElfW(Ehdr) header_;
   size_t phdr_num_;
 
+  // The ELF file up to the end of its section header table, mapped once so that the headers and
+  // sections read below don't each need a mapping of their own. Empty if that is too large or
+  // couldn't be mapped, in which case each of them is mapped separately into its fragment.
+  MappedFileFragment file_fragment_;
+  bool tried_file_fragment_ = false;
+
   MappedFileFragment phdr_fragment_;
   const ElfW(Phdr)* phdr_table_;
 
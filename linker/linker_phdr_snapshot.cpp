@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "linker_phdr_snapshot.h"
+
+#include <stdlib.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+#include "linker_debug.h"
+#include "linker_globals.h"
+
+static std::atomic<PhdrSnapshot*> g_snapshot;
+static std::atomic<unsigned> g_epoch;
+static std::atomic<size_t> g_readers[2];
+// Set by a reader that left a drained epoch while g_dl_mutex was held by someone else.
+static std::atomic<bool> g_reclaim_pending;
+
+// Things withdrawn from readers, and not yet released.
+struct Withdrawn {
+  std::vector<PhdrSnapshot*> snapshots;
+  std::vector<std::pair<void*, size_t>> mappings;
+
+  bool empty() const { return snapshots.empty() && mappings.empty(); }
+
+  void release() {
+    for (PhdrSnapshot* snapshot : snapshots) free(snapshot);
+    // A library and its gap, or libraries loaded one after the other, are often adjacent, so
+    // merge what can be merged and unmap it with one call.
+    std::sort(mappings.begin(), mappings.end());
+    size_t munmaps = 0;
+    for (size_t i = 0; i < mappings.size();) {
+      char* start = static_cast<char*>(mappings[i].first);
+      char* end = start + mappings[i].second;
+      for (++i; i < mappings.size() && mappings[i].first == end; ++i) {
+        end += mappings[i].second;
+      }
+      munmap(start, end - start);
+      ++munmaps;
+    }
+    LD_DEBUG(any, "dl_iterate_phdr: released %zu snapshots and %zu mappings (%zu munmaps)",
+             snapshots.size(), mappings.size(), munmaps);
+    snapshots.clear();
+    mappings.clear();
+  }
+};
+
+// Withdrawn during the current epoch.
+static Withdrawn g_withdrawn;
+// Withdrawn before the last epoch change, waiting for that epoch's readers to leave.
+static Withdrawn g_draining;
+
+static bool epoch_drained(unsigned epoch) {
+  return g_readers[epoch & 1].load() == 0;
+}
+
+static size_t g_batch_depth;
+
+// Releases whatever no reader can still see. Never blocks.
+static void phdr_snapshot_reclaim() {
+  if (g_batch_depth > 0) return;
+
+  unsigned epoch = g_epoch.load(std::memory_order_relaxed);
+  if (!g_draining.empty()) {
+    // The readers of the previous epoch must all leave before the epoch can advance again,
+    // because new readers would start counting in the same slot.
+    if (!epoch_drained(epoch - 1)) return;
+    g_draining.release();
+  }
+  if (g_withdrawn.empty()) return;
+
+  g_epoch.store(epoch + 1);
+  std::swap(g_draining, g_withdrawn);
+  if (epoch_drained(epoch)) g_draining.release();
+}
+
+PhdrSnapshot* phdr_snapshot_alloc(size_t count, size_t names_size) {
+  size_t size = sizeof(PhdrSnapshot) + count * sizeof(PhdrSnapshotEntry) + names_size;
+  char* p = static_cast<char*>(malloc(size));
+  if (p == nullptr) return nullptr;
+  PhdrSnapshot* snapshot = reinterpret_cast<PhdrSnapshot*>(p);
+  snapshot->count = count;
+  snapshot->entries = reinterpret_cast<PhdrSnapshotEntry*>(p + sizeof(PhdrSnapshot));
+  snapshot->names = p + sizeof(PhdrSnapshot) + count * sizeof(PhdrSnapshotEntry);
+  return snapshot;
+}
+
+void phdr_snapshot_publish(PhdrSnapshot* snapshot) {
+  phdr_snapshot_invalidate();
+  g_snapshot.store(snapshot, std::memory_order_release);
+}
+
+void phdr_snapshot_invalidate() {
+  if (PhdrSnapshot* old = g_snapshot.exchange(nullptr)) {
+    g_withdrawn.snapshots.push_back(old);
+  }
+  phdr_snapshot_reclaim();
+}
+
+void phdr_snapshot_unmap(void* addr, size_t size) {
+  phdr_snapshot_invalidate();
+  g_withdrawn.mappings.emplace_back(addr, size);
+  phdr_snapshot_reclaim();
+}
+
+void phdr_snapshot_reclaim_pending() {
+  // Whoever holds g_dl_mutex when this gives up checks again after unlocking it, so a request
+  // can't be lost between the two.
+  while (g_reclaim_pending.load(std::memory_order_acquire)) {
+    if (pthread_mutex_trylock(&g_dl_mutex) != 0) return;
+    g_reclaim_pending.store(false);
+    ++g_dl_mutex_depth;
+    phdr_snapshot_reclaim();
+    --g_dl_mutex_depth;
+    pthread_mutex_unlock(&g_dl_mutex);
+  }
+}
+
+ScopedPhdrSnapshotBatch::ScopedPhdrSnapshotBatch() {
+  ++g_batch_depth;
+}
+
+ScopedPhdrSnapshotBatch::~ScopedPhdrSnapshotBatch() {
+  if (--g_batch_depth == 0) phdr_snapshot_reclaim();
+}
+
+static void leave_epoch(unsigned slot) {
+  // If the epoch moved on while we were counted, things withdrawn before that may only have been
+  // waiting for us.
+  if (g_readers[slot].fetch_sub(1) == 1 && (g_epoch.load() & 1) != slot) {
+    g_reclaim_pending.store(true, std::memory_order_release);
+    phdr_snapshot_reclaim_pending();
+  }
+}
+
+ScopedPhdrSnapshot::ScopedPhdrSnapshot() {
+  // Count ourselves as a reader of the epoch that is still current after we did so; a loader
+  // that advances the epoch after that point is guaranteed to see us.
+  while (true) {
+    unsigned epoch = g_epoch.load();
+    slot_ = epoch & 1;
+    g_readers[slot_].fetch_add(1);
+    if (g_epoch.load() == epoch) break;
+    leave_epoch(slot_);
+  }
+  snapshot_ = g_snapshot.load(std::memory_order_acquire);
+}
+
+ScopedPhdrSnapshot::~ScopedPhdrSnapshot() {
+  leave_epoch(slot_);
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <link.h>
+#include <stddef.h>
+
+#include <android-base/macros.h>
+
+// Lock-free dl_iterate_phdr().
+//
+// Unwinders call dl_iterate_phdr() for every exception thrown, so it must not serialize threads on
+// g_dl_mutex. Instead the loader publishes an immutable snapshot of what dl_iterate_phdr() reports
+// for each library, which readers iterate without any lock. Whenever the set of loaded libraries
+// changes the snapshot is withdrawn, and the next dl_iterate_phdr() takes the lock, iterates the
+// live list and publishes a new one.
+//
+// Withdrawn snapshots, and the mappings of libraries unloaded while a reader may still be looking
+// at their program headers, are only released once every reader that could have seen them is
+// done. Readers announce themselves in one of two counters, selected by the parity of an epoch
+// that is advanced whenever something is withdrawn; something withdrawn before the epoch moved
+// from E to E+1 can be released once the counter for E drops to zero. This is checked without
+// blocking on every loader operation, so unloading never waits for a reader. The last reader to
+// leave an epoch that has been left behind releases what was waiting for it, or, if the loader is
+// busy, leaves that to whoever unlocks g_dl_mutex next.
+
+struct PhdrSnapshotEntry {
+  ElfW(Addr) addr;
+  const char* name;
+  const ElfW(Phdr)* phdr;
+  ElfW(Half) phnum;
+  size_t tls_modid;
+  // Copied from the TlsModule, since the module table may be reallocated under a reader.
+  size_t tls_static_offset;
+  size_t tls_first_generation;
+};
+
+struct PhdrSnapshot {
+  unsigned long long adds;
+  unsigned long long subs;
+  // The TLS generation when the snapshot was published. A thread whose DTV is newer may have
+  // reused one of the snapshot's module IDs for another library.
+  size_t tls_generation;
+  size_t count;
+  PhdrSnapshotEntry* entries;
+  // Storage for the entries' names.
+  char* names;
+};
+
+// Allocates a snapshot with room for `count` entries and `names_size` bytes of names.
+PhdrSnapshot* phdr_snapshot_alloc(size_t count, size_t names_size);
+
+// The following must be called with g_dl_mutex held.
+
+// Makes `snapshot` the one lock-free readers see. Takes ownership of `snapshot`.
+void phdr_snapshot_publish(PhdrSnapshot* snapshot);
+
+// Withdraws the current snapshot, if any. Called whenever solist or the load/unload counters change.
+void phdr_snapshot_invalidate();
+
+// Unmaps [addr, addr + size) once no lock-free reader can be looking at it.
+void phdr_snapshot_unmap(void* addr, size_t size);
+
+// Releases what a reader leaving the last epoch asked to be released, if g_dl_mutex is free.
+// Called without g_dl_mutex held, after unlocking it.
+void phdr_snapshot_reclaim_pending();
+
+// Holds back releasing withdrawn snapshots and mappings until the outermost batch ends, so that
+// unloading a whole group of libraries unmaps them in one pass, merging adjacent ranges.
+class ScopedPhdrSnapshotBatch {
+ public:
+  ScopedPhdrSnapshotBatch();
+  ~ScopedPhdrSnapshotBatch();
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ScopedPhdrSnapshotBatch);
+};
+
+// Holds the current snapshot, which may be nullptr, for the lifetime of the object.
+class ScopedPhdrSnapshot {
+ public:
+  ScopedPhdrSnapshot();
+  ~ScopedPhdrSnapshot();
+
+  const PhdrSnapshot* get() const { return snapshot_; }
+
+ private:
+  size_t slot_;
+  const PhdrSnapshot* snapshot_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedPhdrSnapshot);
+};
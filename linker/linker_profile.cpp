@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "linker_profile.h"
+
+#include <time.h>
+
+#include <unordered_map>
+
+#include "linker_debug.h"
+#include "linker_soinfo.h"
+
+static std::unordered_map<const soinfo*, LinkerProfile> g_profiles;
+
+uint64_t linker_profile_now_ns() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+LinkerProfile* linker_profile_for(const soinfo* si) {
+  if (!g_linker_debug_config.profile || si->is_linker()) {
+    return nullptr;
+  }
+  return &g_profiles[si];
+}
+
+void linker_profile_report(const soinfo* si) {
+  auto it = g_profiles.find(si);
+  if (it == g_profiles.end()) {
+    return;
+  }
+  const LinkerProfile& profile = it->second;
+  LD_DEBUG(profile,
+           "PROFILE: %s: relocated in %lld us (%d abs, %d rel, %d symbol: %d cached, "
+           "%d memoized, %d from binding cache, %d looked up, %d unresolved), "
+           "constructors took %lld us",
+           si->get_realpath(),
+           static_cast<long long>(profile.relocate_ns / 1000),
+           profile.reloc_count[kRelocAbsolute],
+           profile.reloc_count[kRelocRelative],
+           profile.reloc_count[kRelocSymbol],
+           profile.reloc_count[kRelocSymbolCached],
+           profile.reloc_count[kRelocSymbolMemoized],
+           profile.reloc_count[kRelocSymbolBound],
+           profile.reloc_count[kRelocSymbolLookup],
+           profile.reloc_count[kRelocSymbolUnresolved],
+           static_cast<long long>(profile.constructors_ns / 1000));
+  g_profiles.erase(it);
+}
+
+void linker_profile_forget(const soinfo* si) {
+  g_profiles.erase(si);
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "linker_relocate.h"
+
+// A per-library profile of the work done to load it, collected when LD_DEBUG includes "profile".
+// Each library's profile is logged once its constructors have run:
+//
+//   PROFILE: /system/lib64/libfoo.so: relocated in 812 us (10 abs, 5120 rel, 2048 symbol:
+//   1024 cached, 0 from binding cache, 1024 looked up, 3 unresolved), constructors took 95 us
+//
+// Relocation and constructors also show up as systrace sections for every library, whether or
+// not profiling is enabled.
+struct LinkerProfile {
+  int reloc_count[kRelocMax];
+  uint64_t relocate_ns;
+  uint64_t constructors_ns;
+};
+
+uint64_t linker_profile_now_ns();
+
+// Returns the profile of `si`, or nullptr if profiling is disabled.
+LinkerProfile* linker_profile_for(const soinfo* si);
+
+// Logs the profile of `si` and discards it.
+void linker_profile_report(const soinfo* si);
+
+// Discards the profile of `si` (for libraries that fail to load).
+void linker_profile_forget(const soinfo* si);
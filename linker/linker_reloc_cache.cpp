@@ -0,0 +1,290 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "linker_reloc_cache.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <android-base/stringprintf.h>
+
+#include "linker_debug.h"
+#include "linker_gnu_hash.h"
+#include "linker_namespaces.h"
+#include "linker_relocate.h"
+#include "private/elf_note.h"
+
+static constexpr char kMagic[4] = { 'L', 'R', 'B', 'C' };
+static constexpr uint32_t kVersion = 1;
+
+// Entry::lib_index values that don't name a library in the lookup list.
+static constexpr uint32_t kNoBinding = UINT32_MAX;
+static constexpr uint32_t kUndefinedWeak = UINT32_MAX - 1;
+
+// HashedRange::begin of a library whose range hasn't been computed yet.
+static constexpr uint32_t kRangeUnknown = UINT32_MAX;
+
+struct RelocBindingCacheHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t key;
+  uint32_t lib_count;
+  uint32_t entry_count;
+};
+
+static std::string g_reloc_cache_dir;
+
+void set_reloc_cache_dir(const char* dir) {
+  g_reloc_cache_dir = (dir != nullptr) ? dir : "";
+}
+
+// 64-bit FNV-1a. This only needs to detect changes, not resist an adversary: the cache directory
+// is chosen by the process itself.
+static uint64_t fnv1a(uint64_t hash, const void* data, size_t size) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ p[i]) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+static constexpr uint64_t kFnvOffsetBasis = 0xcbf29ce484222325ULL;
+
+static bool hash_build_id(uint64_t* hash, const soinfo* si) {
+  const ElfW(Nhdr)* note_hdr = nullptr;
+  const char* note_desc = nullptr;
+  if (!__find_elf_note(NT_GNU_BUILD_ID, "GNU", si->phdr, si->phnum, &note_hdr, &note_desc,
+                       si->load_bias)) {
+    return false;
+  }
+  const uint32_t size = note_hdr->n_descsz;
+  *hash = fnv1a(*hash, &size, sizeof(size));
+  *hash = fnv1a(*hash, note_desc, size);
+  return true;
+}
+
+RelocBindingCache::~RelocBindingCache() {
+  if (map_ != nullptr) munmap(map_, map_size_);
+}
+
+bool RelocBindingCache::init(soinfo* si, const SymbolLookupList& lookup_list) {
+  if (g_reloc_cache_dir.empty() || si->is_linker()) return false;
+  // SysV-only libraries aren't described well enough by SymbolLookupLib to verify a binding.
+  if (lookup_list.needs_slow_path()) return false;
+
+  si_ = si;
+  lookup_list_ = &lookup_list;
+  lib_count_ = lookup_list.end() - lookup_list.begin();
+
+  const char* ns_name = si->get_primary_namespace()->get_name();
+  const char* realpath = si->get_realpath();
+
+  // The file name identifies the DSO; the key stored inside identifies the exact set of
+  // libraries it was linked against.
+  uint64_t name_hash = fnv1a(kFnvOffsetBasis, ns_name, strlen(ns_name) + 1);
+  name_hash = fnv1a(name_hash, realpath, strlen(realpath) + 1);
+  path_ = android::base::StringPrintf("%s/%016llx.relocbind", g_reloc_cache_dir.c_str(),
+                                      static_cast<unsigned long long>(name_hash));
+
+  key_ = name_hash;
+  if (!hash_build_id(&key_, si)) {
+    LD_DEBUG(reloc, "[ no build-id for \"%s\"; not using the binding cache ]", realpath);
+    return false;
+  }
+  for (const SymbolLookupLib* lib = lookup_list.begin(); lib != lookup_list.end(); ++lib) {
+    if (!hash_build_id(&key_, lib->si_)) {
+      LD_DEBUG(reloc, "[ no build-id for \"%s\"; not using the binding cache for \"%s\" ]",
+               lib->si_->get_realpath(), realpath);
+      return false;
+    }
+    // A library can appear more than once; record() uses its first position, like the lookup.
+    lib_indexes_.emplace(lib->si_, lib - lookup_list.begin());
+  }
+  hashed_ranges_.assign(lib_count_, HashedRange { kRangeUnknown, 0 });
+
+  if (map_existing()) {
+    LD_DEBUG(reloc, "[ using binding cache \"%s\" for \"%s\" ]", path_.c_str(), realpath);
+  } else {
+    LD_DEBUG(reloc, "[ recording binding cache \"%s\" for \"%s\" ]", path_.c_str(), realpath);
+  }
+  return true;
+}
+
+bool RelocBindingCache::map_existing() {
+  int fd = TEMP_FAILURE_RETRY(open(path_.c_str(), O_RDONLY | O_CLOEXEC));
+  if (fd == -1) return false;
+
+  struct stat sb;
+  if (fstat(fd, &sb) == -1 || static_cast<size_t>(sb.st_size) < sizeof(RelocBindingCacheHeader)) {
+    close(fd);
+    return false;
+  }
+  // Bindings from a file someone else could have written aren't trusted.
+  if (!S_ISREG(sb.st_mode) || (sb.st_uid != 0 && sb.st_uid != geteuid()) ||
+      (sb.st_mode & (S_IWGRP | S_IWOTH)) != 0) {
+    LD_DEBUG(reloc, "[ ignoring binding cache \"%s\" with uid %d and mode %o ]", path_.c_str(),
+             static_cast<int>(sb.st_uid), static_cast<unsigned>(sb.st_mode & 07777));
+    close(fd);
+    return false;
+  }
+
+  void* map = mmap(nullptr, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) return false;
+
+  const auto* header = static_cast<const RelocBindingCacheHeader*>(map);
+  if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 ||
+      header->version != kVersion ||
+      header->key != key_ ||
+      header->lib_count != lib_count_ ||
+      static_cast<size_t>(sb.st_size) !=
+          sizeof(*header) + static_cast<size_t>(header->entry_count) * sizeof(Entry)) {
+    LD_DEBUG(reloc, "[ binding cache \"%s\" is stale ]", path_.c_str());
+    munmap(map, sb.st_size);
+    return false;
+  }
+
+  map_ = map;
+  map_size_ = sb.st_size;
+  mapped_entries_ = reinterpret_cast<const Entry*>(header + 1);
+  mapped_entry_count_ = header->entry_count;
+  return true;
+}
+
+const RelocBindingCache::HashedRange& RelocBindingCache::hashed_range(uint32_t lib_index) {
+  HashedRange& range = hashed_ranges_[lib_index];
+  if (range.begin != kRangeUnknown) return range;
+
+  // Every symbol that can be found by a lookup is in the hash table, so that's all a binding may
+  // name. The chain of the highest bucket runs until the last symbol of the table.
+  const SymbolLookupLib& lib = lookup_list_->begin()[lib_index];
+  uint32_t begin = UINT32_MAX;
+  uint32_t last = 0;
+  for (size_t i = 0; i < lib.gnu_nbucket_; ++i) {
+    uint32_t n = lib.gnu_bucket_[i];
+    if (n == 0) continue;
+    begin = std::min(begin, n);
+    last = std::max(last, n);
+  }
+  if (last == 0) {
+    range = { 0, 0 };
+  } else {
+    while ((lib.gnu_chain_[last] & 1) == 0) ++last;
+    range = { begin, last + 1 };
+  }
+  return range;
+}
+
+bool RelocBindingCache::lookup(uint32_t r_sym, const char* sym_name,
+                               soinfo** found_in, const ElfW(Sym)** sym) {
+  if (r_sym >= mapped_entry_count_) return false;
+
+  const Entry& entry = mapped_entries_[r_sym];
+  if (entry.lib_index == kUndefinedWeak) {
+    *found_in = nullptr;
+    *sym = nullptr;
+    return true;
+  }
+  if (entry.lib_index >= lib_count_) return false;
+
+  // The build-ids matched, so this should always succeed, but a truncated or corrupted file
+  // must not produce a wrong binding.
+  const HashedRange& range = hashed_range(entry.lib_index);
+  if (entry.sym_index < range.begin || entry.sym_index >= range.end) return false;
+  const SymbolLookupLib& lib = lookup_list_->begin()[entry.lib_index];
+  // The chain holds the hash of each symbol, apart from the low bit.
+  if (((lib.gnu_chain_[entry.sym_index] ^ calculate_gnu_hash(sym_name).first) >> 1) != 0) {
+    return false;
+  }
+  const ElfW(Sym)* s = lib.symtab_ + entry.sym_index;
+  if (s->st_name >= lib.strtab_size_ ||
+      strcmp(lib.strtab_ + s->st_name, sym_name) != 0 ||
+      !is_symbol_global_and_defined(lib.si_, s)) {
+    return false;
+  }
+
+  *found_in = lib.si_;
+  *sym = s;
+  return true;
+}
+
+void RelocBindingCache::record(uint32_t r_sym, const soinfo* found_in, const ElfW(Sym)* sym) {
+  Entry entry = { kUndefinedWeak, 0 };
+  if (sym != nullptr) {
+    auto it = lib_indexes_.find(found_in);
+    if (it == lib_indexes_.end()) return;
+    entry.lib_index = it->second;
+    entry.sym_index = sym - lookup_list_->begin()[it->second].symtab_;
+  }
+
+  if (entries_.empty() && mapped_entry_count_ > 0) {
+    entries_.assign(mapped_entries_, mapped_entries_ + mapped_entry_count_);
+  }
+  if (r_sym >= entries_.size()) entries_.resize(r_sym + 1, Entry { kNoBinding, 0 });
+  entries_[r_sym] = entry;
+  dirty_ = true;
+}
+
+void RelocBindingCache::finish() {
+  if (!dirty_) return;
+
+  RelocBindingCacheHeader header = {};
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.key = key_;
+  header.lib_count = lib_count_;
+  header.entry_count = entries_.size();
+
+  // Write to a temporary file and rename it into place so that a concurrently starting process
+  // never sees a partial file.
+  std::string tmp_path = android::base::StringPrintf("%s.%d", path_.c_str(), getpid());
+  int fd = TEMP_FAILURE_RETRY(open(tmp_path.c_str(),
+                                   O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600));
+  if (fd == -1) {
+    LD_DEBUG(reloc, "[ couldn't create binding cache \"%s\": %m ]", tmp_path.c_str());
+    return;
+  }
+  const size_t entries_size = entries_.size() * sizeof(Entry);
+  bool ok = TEMP_FAILURE_RETRY(write(fd, &header, sizeof(header))) ==
+                static_cast<ssize_t>(sizeof(header)) &&
+            TEMP_FAILURE_RETRY(write(fd, entries_.data(), entries_size)) ==
+                static_cast<ssize_t>(entries_size);
+  close(fd);
+  if (!ok || rename(tmp_path.c_str(), path_.c_str()) == -1) {
+    LD_DEBUG(reloc, "[ couldn't write binding cache \"%s\": %m ]", path_.c_str());
+    unlink(tmp_path.c_str());
+    return;
+  }
+  dirty_ = false;
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <link.h>
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <android-base/macros.h>
+
+#include "linker_soinfo.h"
+
+// A persistent, opt-in cache of symbol bindings produced by relocation.
+//
+// When LD_RELOC_CACHE_DIR names a writable directory, the linker records, for each DSO it
+// relocates, which library in the lookup list (and which symbol index within it) every symbolic
+// relocation resolved to. The record is keyed by the build-ids of the DSO and of every library in
+// its lookup list, in order, together with the DSO's path and namespace. On the next run with the
+// same key, symbol lookups are served from the record instead of walking the SymbolLookupList.
+// If any build-id (or the lookup order) changes, the key no longer matches and the record is
+// rewritten.
+//
+// Only references without symbol version information are served from the cache, and a cache
+// file is only used if it is owned by root or the process's effective uid and nobody else can
+// write to it. The cache is ignored for AT_SECURE processes.
+void set_reloc_cache_dir(const char* dir);
+
+class RelocBindingCache {
+ public:
+  RelocBindingCache() = default;
+  ~RelocBindingCache();
+
+  // Returns false if caching is disabled or not possible for this DSO (e.g. a library in the
+  // lookup list has no build-id).
+  bool init(soinfo* si, const SymbolLookupList& lookup_list);
+
+  // Returns true and fills in found_in/sym if the cache has a binding for r_sym. A null sym with
+  // a true return means the symbol was an unresolved weak reference. Must only be called for
+  // references without version information.
+  bool lookup(uint32_t r_sym, const char* sym_name, soinfo** found_in, const ElfW(Sym)** sym);
+
+  // Records the result of a lookup that wasn't served from the cache.
+  void record(uint32_t r_sym, const soinfo* found_in, const ElfW(Sym)* sym);
+
+  // Called after the DSO was relocated successfully. Writes the record if anything new was
+  // learned.
+  void finish();
+
+  struct Entry {
+    uint32_t lib_index;
+    uint32_t sym_index;
+  };
+
+ private:
+  // The range of symbol indexes covered by a library's GNU hash table.
+  struct HashedRange {
+    uint32_t begin;
+    uint32_t end;
+  };
+
+  bool map_existing();
+  const HashedRange& hashed_range(uint32_t lib_index);
+
+  const soinfo* si_ = nullptr;
+  const SymbolLookupList* lookup_list_ = nullptr;
+  size_t lib_count_ = 0;
+  uint64_t key_ = 0;
+  std::string path_;
+
+  void* map_ = nullptr;
+  size_t map_size_ = 0;
+  const Entry* mapped_entries_ = nullptr;
+  size_t mapped_entry_count_ = 0;
+
+  // Computed on first use, for each library in the lookup list.
+  std::vector<HashedRange> hashed_ranges_;
+  std::unordered_map<const soinfo*, uint32_t> lib_indexes_;
+
+  std::vector<Entry> entries_;
+  bool dirty_ = false;
+
+  DISALLOW_COPY_AND_ASSIGN(RelocBindingCache);
+};
@@ -37,12 +37,16 @@
 #include "linker_debug.h"
 #include "linker_globals.h"
 #include "linker_gnu_hash.h"
+#include "linker_lazy_bind.h"
 #include "linker_phdr.h"
+#include "linker_profile.h"
+#include "linker_reloc_cache.h"
 #include "linker_relocs.h"
 #include "linker_reloc_iterators.h"
 #include "linker_sleb128.h"
 #include "linker_soinfo.h"
 #include "private/bionic_globals.h"
+#include "private/bionic_systrace.h"
 
 #include <platform/bionic/mte.h>
 
@@ -80,6 +84,26 @@ class Relocator {
   const ElfW(Sym)* cache_sym = nullptr;
   soinfo* cache_si = nullptr;
 
+  // Every symbol resolved so far, direct-mapped by symbol index. The cache above only catches
+  // consecutive references to a symbol; this also catches the ones spread out over the
+  // relocations, like a vtable's or a GLOB_DAT and JUMP_SLOT for the same function.
+  struct SymbolMemoEntry {
+    ElfW(Word) r_sym;
+    const ElfW(Sym)* sym;
+    soinfo* si;
+  };
+  static constexpr size_t kSymbolMemoSize = 512;
+  std::vector<SymbolMemoEntry> symbol_memo;
+
+  // Symbol index 0 is never looked up, so a zeroed entry is empty.
+  SymbolMemoEntry* symbol_memo_entry(ElfW(Word) r_sym) {
+    if (__predict_false(symbol_memo.empty())) symbol_memo.resize(kSymbolMemoSize);
+    return &symbol_memo[r_sym % kSymbolMemoSize];
+  }
+
+  // Persistent bindings from an earlier run, if LD_RELOC_CACHE_DIR is set.
+  RelocBindingCache* binding_cache = nullptr;
+
   std::vector<TlsDynamicResolverArg>* tlsdesc_args;
   std::vector<std::pair<TlsDescriptor*, size_t>> deferred_tlsdesc_relocs;
   size_t tls_tp_base = 0;
@@ -103,13 +127,35 @@ static inline bool lookup_symbol(Relocator& relocator, uint32_t r_sym, const cha
     *sym = relocator.cache_sym;
     count_relocation_if<DoLogging>(kRelocSymbolCached);
   } else {
-    const version_info* vi = nullptr;
-    if (!relocator.si->lookup_version_info(relocator.version_tracker, r_sym, sym_name, &vi)) {
-      return false;
-    }
-
     soinfo* local_found_in = nullptr;
-    const ElfW(Sym)* local_sym = soinfo_do_lookup(sym_name, vi, &local_found_in, relocator.lookup_list);
+    const ElfW(Sym)* local_sym = nullptr;
+
+    Relocator::SymbolMemoEntry* memo = relocator.symbol_memo_entry(r_sym);
+    if (memo->r_sym == r_sym) {
+      local_found_in = memo->si;
+      local_sym = memo->sym;
+      count_relocation_if<DoLogging>(kRelocSymbolMemoized);
+    } else {
+      const version_info* vi = nullptr;
+      if (!relocator.si->lookup_version_info(relocator.version_tracker, r_sym, sym_name, &vi)) {
+        return false;
+      }
+
+      // The binding cache doesn't record which version a binding matched, so versioned
+      // references always take the slow path.
+      RelocBindingCache* binding_cache = (vi == nullptr) ? relocator.binding_cache : nullptr;
+      if (binding_cache != nullptr &&
+          binding_cache->lookup(r_sym, sym_name, &local_found_in, &local_sym)) {
+        count_relocation_if<DoLogging>(kRelocSymbolBound);
+      } else {
+        local_sym = soinfo_do_lookup(sym_name, vi, &local_found_in, relocator.lookup_list);
+        count_relocation_if<DoLogging>(kRelocSymbolLookup);
+        if (binding_cache != nullptr) {
+          binding_cache->record(r_sym, local_found_in, local_sym);
+        }
+      }
+    }
+    *memo = { r_sym, local_sym, local_found_in };
 
     relocator.cache_sym_val = r_sym;
     relocator.cache_si = local_found_in;
@@ -123,6 +169,7 @@ static inline bool lookup_symbol(Relocator& relocator, uint32_t r_sym, const cha
       DL_ERR("cannot locate symbol \"%s\" referenced by \"%s\"...", sym_name, relocator.si->get_realpath());
       return false;
     }
+    count_relocation_if<DoLogging>(kRelocSymbolUnresolved);
   }
 
   count_relocation_if<DoLogging>(kRelocSymbol);
@@ -150,14 +197,55 @@ void count_relocation(RelocationKind kind) {
 
 void print_linker_stats() {
   LD_DEBUG(statistics,
-           "RELO STATS: %s: %d abs, %d rel, %d symbol (%d cached)",
+           "RELO STATS: %s: %d abs, %d rel, %d symbol (%d cached, %d memoized, "
+           "%d from binding cache)",
            g_argv[0],
            linker_stats.count[kRelocAbsolute],
            linker_stats.count[kRelocRelative],
            linker_stats.count[kRelocSymbol],
-           linker_stats.count[kRelocSymbolCached]);
+           linker_stats.count[kRelocSymbolCached],
+           linker_stats.count[kRelocSymbolMemoized],
+           linker_stats.count[kRelocSymbolBound]);
 }
 
+// Attributes the relocations counted while it's in scope, and the time taken, to the profile of
+// a library, and wraps them in a systrace section if tracing is enabled.
+class ScopedRelocateProfile {
+ public:
+  explicit ScopedRelocateProfile(const soinfo* si)
+      : si_(si), profile_(linker_profile_for(si)), start_ns_(0),
+        traced_(!si->is_linker() && bionic_trace_enabled()) {
+    if (traced_) {
+      bionic_trace_begin((std::string("relocating: ") + si_->get_realpath()).c_str());
+    }
+    if (profile_ != nullptr) {
+      start_stats_ = linker_stats;
+      start_ns_ = linker_profile_now_ns();
+    }
+  }
+
+  ~ScopedRelocateProfile() {
+    if (profile_ != nullptr) {
+      profile_->relocate_ns += linker_profile_now_ns() - start_ns_;
+      for (int kind = 0; kind < kRelocMax; ++kind) {
+        profile_->reloc_count[kind] += linker_stats.count[kind] - start_stats_.count[kind];
+      }
+    }
+    if (traced_) {
+      bionic_trace_end();
+    }
+  }
+
+ private:
+  const soinfo* si_;
+  LinkerProfile* profile_;
+  linker_stats_t start_stats_;
+  uint64_t start_ns_;
+  bool traced_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedRelocateProfile);
+};
+
 static bool process_relocation_general(Relocator& relocator, const rel_t& reloc);
 
 template <RelocMode Mode>
@@ -443,9 +531,9 @@ static bool process_relocation_impl(Relocator& relocator, const rel_t& reloc) {
       }
       break;
 
-#if defined(__aarch64__) || defined(__riscv)
-    // Bionic currently implements TLSDESC for arm64 and riscv64. This implementation should work
-    // with other architectures, as long as the resolver functions are implemented.
+#if defined(__aarch64__) || defined(__riscv) || defined(__x86_64__)
+    // Bionic currently implements TLSDESC for arm64, riscv64, and x86_64. This implementation
+    // should work with other architectures, as long as the resolver functions are implemented.
     case R_GENERIC_TLSDESC:
       count_relocation_if<IsGeneral>(kRelocRelative);
       {
@@ -487,7 +575,7 @@ static bool process_relocation_impl(Relocator& relocator, const rel_t& reloc) {
         }
       }
       break;
-#endif  // defined(__aarch64__) || defined(__riscv)
+#endif  // defined(__aarch64__) || defined(__riscv) || defined(__x86_64__)
 
 #if defined(__x86_64__)
     case R_X86_64_32:
@@ -589,6 +677,27 @@ static bool packed_relocate(Relocator& relocator, Args ...args) {
       packed_relocate_impl<OptMode>(relocator, args...);
 }
 
+// Applies the PLT relocations of a library that is bound lazily: every JUMP_SLOT still holds
+// the link-time address of its PLT stub, which only needs rebasing to go through the lazy
+// binding trampoline on its first call. Anything else is relocated as usual.
+static bool lazy_relocate(Relocator& relocator, const rel_t* rels, size_t rel_count) {
+  if (!lazy_bind_prepare(relocator.si, relocator.si_symtab, rels, rel_count)) {
+    return false;
+  }
+  const ElfW(Addr) load_bias = relocator.si->load_bias;
+  for (size_t i = 0; i < rel_count; ++i) {
+    // Calls to a function with a variant procedure call standard can't go through the
+    // trampoline, so bind them now.
+    if (ELFW(R_TYPE)(rels[i].r_info) == R_GENERIC_JUMP_SLOT &&
+        !is_variant_pcs_symbol(relocator.si_symtab[ELFW(R_SYM)(rels[i].r_info)])) {
+      *reinterpret_cast<ElfW(Addr)*>(rels[i].r_offset + load_bias) += load_bias;
+    } else if (!process_relocation_general(relocator, rels[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
 bool soinfo::relocate(const SymbolLookupList& lookup_list) {
   // For ldd, don't apply relocations because TLS segments are not registered.
   // We don't care whether ldd diagnoses unresolved symbols.
@@ -596,6 +705,7 @@ bool soinfo::relocate(const SymbolLookupList& lookup_list) {
     return true;
   }
 
+  ScopedRelocateProfile profile(this);
   VersionTracker version_tracker;
 
   if (!version_tracker.init(this)) {
@@ -610,6 +720,11 @@ bool soinfo::relocate(const SymbolLookupList& lookup_list) {
   relocator.tlsdesc_args = &tlsdesc_args_;
   relocator.tls_tp_base = __libc_shared_globals()->static_tls_layout.offset_thread_pointer();
 
+  RelocBindingCache binding_cache;
+  if (binding_cache.init(this, lookup_list)) {
+    relocator.binding_cache = &binding_cache;
+  }
+
   // The linker already applied its RELR relocations in an earlier pass, so
   // skip the RELR relocations for the linker.
   if (relr_ != nullptr && !is_linker()) {
@@ -652,7 +767,11 @@ bool soinfo::relocate(const SymbolLookupList& lookup_list) {
   }
   if (plt_rela_ != nullptr) {
     LD_DEBUG(reloc, "[ relocating %s plt rela ]", get_realpath());
-    if (!plain_relocate<RelocMode::JumpTable>(relocator, plt_rela_, plt_rela_count_)) {
+    if (lazy_bind_wanted(this)) {
+      if (!lazy_relocate(relocator, plt_rela_, plt_rela_count_)) {
+        return false;
+      }
+    } else if (!plain_relocate<RelocMode::JumpTable>(relocator, plt_rela_, plt_rela_count_)) {
       return false;
     }
   }
@@ -673,14 +792,18 @@ bool soinfo::relocate(const SymbolLookupList& lookup_list) {
 
   // Once the tlsdesc_args_ vector's size is finalized, we can write the addresses of its elements
   // into the TLSDESC relocations.
-#if defined(__aarch64__) || defined(__riscv)
-  // Bionic currently only implements TLSDESC for arm64 and riscv64.
+#if defined(__aarch64__) || defined(__riscv) || defined(__x86_64__)
+  // Bionic currently only implements TLSDESC for arm64, riscv64, and x86_64.
   for (const std::pair<TlsDescriptor*, size_t>& pair : relocator.deferred_tlsdesc_relocs) {
     TlsDescriptor* desc = pair.first;
     desc->func = tlsdesc_resolver_dynamic;
     desc->arg = reinterpret_cast<size_t>(&tlsdesc_args_[pair.second]);
   }
-#endif // defined(__aarch64__) || defined(__riscv)
+#endif // defined(__aarch64__) || defined(__riscv) || defined(__x86_64__)
+
+  if (relocator.binding_cache != nullptr) {
+    binding_cache.finish();
+  }
 
   return true;
 }
@@ -46,6 +46,10 @@ enum RelocationKind {
   kRelocRelative,
   kRelocSymbol,
   kRelocSymbolCached,
+  kRelocSymbolMemoized,
+  kRelocSymbolBound,
+  kRelocSymbolLookup,
+  kRelocSymbolUnresolved,
   kRelocMax
 };
 
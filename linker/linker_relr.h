@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <link.h>
+#include <stddef.h>
+
+// Applies the relative relocations in a SHT_RELR section to the image at `load_bias`. Details
+// of the encoding are described in this post:
+//   https://groups.google.com/d/msg/generic-abi/bX460iggiKg/Pi9aSwwABgAJ
+//
+// An address entry is followed by bitmap entries that each cover the next 63 (31 on 32-bit
+// platforms) words. Rather than shifting a bitmap one bit at a time, this jumps from one set bit
+// to the next, and a fully set bitmap (a run of pointers, such as a vtable) is applied with a
+// plain loop over the words that the compiler vectorizes.
+//
+// The linker also uses this to relocate itself, so it must not call out of line.
+static inline void apply_relr(const ElfW(Relr)* begin, const ElfW(Relr)* end,
+                              ElfW(Addr) load_bias) {
+  constexpr size_t kBitmapWords = 8 * sizeof(ElfW(Relr)) - 1;
+  constexpr ElfW(Relr) kFullBitmap = ~static_cast<ElfW(Relr)>(0) >> 1;
+
+  ElfW(Addr)* base = nullptr;
+  for (const ElfW(Relr)* current = begin; current < end; ++current) {
+    ElfW(Relr) entry = *current;
+
+    if ((entry & 1) == 0) {
+      // Even entry: the offset of the next relocation.
+      ElfW(Addr)* where = reinterpret_cast<ElfW(Addr)*>(load_bias + entry);
+      *where += load_bias;
+      base = where + 1;
+      continue;
+    }
+
+    // Odd entry: a bitmap of relocations starting at base.
+    ElfW(Relr) bitmap = entry >> 1;
+    if (bitmap == kFullBitmap) {
+      for (size_t i = 0; i < kBitmapWords; ++i) {
+        base[i] += load_bias;
+      }
+    } else {
+      while (bitmap != 0) {
+        base[__builtin_ctzll(bitmap)] += load_bias;
+        bitmap &= bitmap - 1;
+      }
+    }
+    base += kBitmapWords;
+  }
+}
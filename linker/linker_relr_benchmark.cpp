@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <link.h>
+
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "linker_relr.h"
+
+// The RELR decoder as it was before apply_relr(), walking every bitmap one bit at a time.
+static void apply_relr_bitwise(const ElfW(Relr)* begin, const ElfW(Relr)* end,
+                               ElfW(Addr) load_bias) {
+  constexpr size_t wordsize = sizeof(ElfW(Addr));
+  ElfW(Addr) base = 0;
+  for (const ElfW(Relr)* current = begin; current < end; ++current) {
+    ElfW(Relr) entry = *current;
+    if ((entry & 1) == 0) {
+      *reinterpret_cast<ElfW(Addr)*>(load_bias + entry) += load_bias;
+      base = entry + wordsize;
+      continue;
+    }
+    ElfW(Addr) offset = base;
+    while (entry != 0) {
+      entry >>= 1;
+      if ((entry & 1) != 0) *reinterpret_cast<ElfW(Addr)*>(load_bias + offset) += load_bias;
+      offset += wordsize;
+    }
+    base += (8 * wordsize - 1) * wordsize;
+  }
+}
+
+// Builds the RELR encoding of an image of `word_count` words where each word is a relocated
+// pointer with the given probability, starting with an address entry for the first word.
+static std::vector<ElfW(Relr)> make_relr(size_t word_count, double density) {
+  constexpr size_t kBitmapWords = 8 * sizeof(ElfW(Relr)) - 1;
+  std::mt19937 rng(1234);
+  std::bernoulli_distribution is_pointer(density);
+  std::vector<ElfW(Relr)> relr = {0};
+  for (size_t base = 1; base < word_count; base += kBitmapWords) {
+    ElfW(Relr) bitmap = 0;
+    for (size_t i = 0; i < kBitmapWords && base + i < word_count; ++i) {
+      if (is_pointer(rng)) bitmap |= static_cast<ElfW(Relr)>(1) << i;
+    }
+    relr.push_back((bitmap << 1) | 1);
+  }
+  return relr;
+}
+
+template <void (*Apply)(const ElfW(Relr)*, const ElfW(Relr)*, ElfW(Addr))>
+static void BM_relr(benchmark::State& state) {
+  // 4MiB of data on 64-bit platforms, like the RELRO of a large C++ library.
+  constexpr size_t kWordCount = 512 * 1024;
+  std::vector<ElfW(Addr)> image(kWordCount + 8 * sizeof(ElfW(Relr)));
+  std::vector<ElfW(Relr)> relr = make_relr(kWordCount, state.range(0) / 100.0);
+  ElfW(Addr) load_bias = reinterpret_cast<ElfW(Addr)>(image.data());
+
+  for (auto _ : state) {
+    Apply(relr.data(), relr.data() + relr.size(), load_bias);
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(state.iterations() * kWordCount * sizeof(ElfW(Addr)));
+}
+
+// The argument is the percentage of words that are relocated pointers.
+BENCHMARK_TEMPLATE(BM_relr, apply_relr)->Arg(10)->Arg(50)->Arg(90)->Arg(100);
+BENCHMARK_TEMPLATE(BM_relr, apply_relr_bitwise)->Arg(10)->Arg(50)->Arg(90)->Arg(100);
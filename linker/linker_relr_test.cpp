@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+#include "linker_relr.h"
+
+// Encodes the relocations at the given word indexes (in increasing order) the way lld does.
+static std::vector<ElfW(Relr)> encode_relr(const std::vector<size_t>& indexes) {
+  constexpr size_t kBitmapWords = 8 * sizeof(ElfW(Relr)) - 1;
+  std::vector<ElfW(Relr)> relr;
+  for (size_t i = 0; i < indexes.size();) {
+    relr.push_back(indexes[i] * sizeof(ElfW(Addr)));
+    size_t base = indexes[i++] + 1;
+    while (i < indexes.size() && indexes[i] < base + kBitmapWords) {
+      ElfW(Relr) bitmap = 0;
+      while (i < indexes.size() && indexes[i] < base + kBitmapWords) {
+        bitmap |= static_cast<ElfW(Relr)>(1) << (indexes[i++] - base);
+      }
+      relr.push_back((bitmap << 1) | 1);
+      base += kBitmapWords;
+    }
+  }
+  return relr;
+}
+
+static void check_relr(const std::vector<size_t>& indexes, size_t word_count) {
+  std::vector<ElfW(Addr)> image(word_count);
+  for (size_t i = 0; i < word_count; ++i) image[i] = i;
+  std::vector<ElfW(Relr)> relr = encode_relr(indexes);
+
+  // Relocation offsets are relative to the image, so its address is the load bias.
+  ElfW(Addr) load_bias = reinterpret_cast<ElfW(Addr)>(image.data());
+  apply_relr(relr.data(), relr.data() + relr.size(), load_bias);
+
+  std::vector<ElfW(Addr)> expected(word_count);
+  for (size_t i = 0; i < word_count; ++i) expected[i] = i;
+  for (size_t index : indexes) expected[index] += load_bias;
+  ASSERT_EQ(expected, image);
+}
+
+TEST(linker_relr, empty) {
+  check_relr({}, 16);
+}
+
+TEST(linker_relr, address_entries_only) {
+  check_relr({0, 100, 200, 300}, 400);
+}
+
+TEST(linker_relr, full_bitmaps) {
+  // A run of pointers long enough for several fully set bitmaps and a partial one.
+  std::vector<size_t> indexes;
+  for (size_t i = 10; i < 10 + 1 + 3 * (8 * sizeof(ElfW(Relr)) - 1) + 5; ++i) indexes.push_back(i);
+  check_relr(indexes, 400);
+}
+
+TEST(linker_relr, random) {
+  std::mt19937 rng(1234);
+  for (int round = 0; round < 100; ++round) {
+    std::vector<size_t> indexes;
+    for (size_t i = 0; i < 2000; ++i) {
+      if (rng() % 4 != 0) indexes.push_back(i);
+    }
+    check_relr(indexes, 2000);
+  }
+}
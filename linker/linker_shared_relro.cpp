@@ -0,0 +1,303 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "linker_shared_relro.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+
+#include <android-base/stringprintf.h>
+
+#include "linker.h"
+#include "linker_debug.h"
+#include "linker_namespaces.h"
+#include "linker_phdr.h"
+#include "linker_soinfo.h"
+#include "platform/bionic/page.h"
+
+static constexpr char kMagic[4] = {'L', 'D', 'R', 'R'};
+static constexpr uint32_t kVersion = 2;
+
+// The first page of a RELRO file. The serialized RELRO segments follow at page_size().
+struct SharedRelroHeader {
+  char magic[4];
+  uint32_t version;
+  // The identity of the library file the RELRO segments were produced from.
+  uint64_t lib_dev;
+  uint64_t lib_ino;
+  int64_t lib_size;
+  int64_t lib_mtime_ns;
+  int64_t lib_file_offset;
+  // /proc/sys/kernel/random/boot_id of the boot the file was written in.
+  char boot_id[40];
+  // Where the library was loaded.
+  uint64_t load_start;
+  uint64_t load_size;
+};
+
+struct SharedRelroState {
+  std::string path;
+  SharedRelroHeader header;
+  // The RELRO file to map, or -1 if it should be (re)written once `si` is linked.
+  int fd = -1;
+  // The address space reserved at header.load_start, until the library is mapped into it.
+  void* reserved_start = nullptr;
+  size_t reserved_size = 0;
+};
+
+static std::unordered_map<const soinfo*, SharedRelroState> g_shared_relro_states;
+
+// Reads the current boot's id, so that a file (and the address it records) doesn't outlive the
+// boot it was written in.
+static bool get_boot_id(char (&boot_id)[40]) {
+  static char g_boot_id[40];
+  static bool g_boot_id_read = false;
+  if (!g_boot_id_read) {
+    int fd = TEMP_FAILURE_RETRY(open("/proc/sys/kernel/random/boot_id", O_RDONLY | O_CLOEXEC));
+    if (fd == -1) return false;
+    ssize_t n = TEMP_FAILURE_RETRY(read(fd, g_boot_id, sizeof(g_boot_id) - 1));
+    close(fd);
+    if (n <= 0) return false;
+    g_boot_id[n] = '\0';
+    g_boot_id_read = true;
+  }
+  memcpy(boot_id, g_boot_id, sizeof(boot_id));
+  return true;
+}
+
+// The file's pages stay mapped over the library's GOT after the contents were checked, so only
+// trust a file that nobody but root or ourselves can modify.
+static bool is_trusted_file(int fd, const std::string& path) {
+  struct stat sb;
+  if (TEMP_FAILURE_RETRY(fstat(fd, &sb)) != 0 || !S_ISREG(sb.st_mode)) {
+    return false;
+  }
+  if (sb.st_uid != 0 && sb.st_uid != geteuid()) {
+    LD_DEBUG(any, "[ ignoring shared RELRO file \"%s\" owned by uid %d ]", path.c_str(),
+             static_cast<int>(sb.st_uid));
+    return false;
+  }
+  if ((sb.st_mode & (S_IWGRP | S_IWOTH)) != 0) {
+    LD_DEBUG(any, "[ ignoring shared RELRO file \"%s\" with mode %o ]", path.c_str(),
+             static_cast<unsigned>(sb.st_mode & 07777));
+    return false;
+  }
+  return true;
+}
+
+static bool read_header(int fd, SharedRelroHeader* header) {
+  return TEMP_FAILURE_RETRY(pread64(fd, header, sizeof(*header), 0)) ==
+             static_cast<ssize_t>(sizeof(*header)) &&
+         memcmp(header->magic, kMagic, sizeof(kMagic)) == 0 && header->version == kVersion;
+}
+
+bool shared_relro_reserve(soinfo* si, int fd, off64_t file_offset,
+                          address_space_params* address_space) {
+  android_namespace_t* ns = si->get_primary_namespace();
+  const std::vector<std::string>& libs = ns->get_shared_relro_libs();
+  const char* lib_name = basename(si->get_realpath());
+  if (libs.empty() || std::find(libs.begin(), libs.end(), lib_name) == libs.end()) {
+    return false;
+  }
+
+  struct stat lib_stat;
+  if (TEMP_FAILURE_RETRY(fstat(fd, &lib_stat)) != 0) {
+    return false;
+  }
+
+  char boot_id[40];
+  if (!get_boot_id(boot_id)) {
+    return false;
+  }
+
+  SharedRelroState& state = g_shared_relro_states[si];
+  state.path = ns->get_shared_relro_dir() + "/" + lib_name + ".relro";
+  memcpy(state.header.magic, kMagic, sizeof(kMagic));
+  state.header.version = kVersion;
+  memcpy(state.header.boot_id, boot_id, sizeof(boot_id));
+  state.header.lib_dev = lib_stat.st_dev;
+  state.header.lib_ino = lib_stat.st_ino;
+  state.header.lib_size = lib_stat.st_size;
+  state.header.lib_mtime_ns =
+      static_cast<int64_t>(lib_stat.st_mtim.tv_sec) * 1000000000 + lib_stat.st_mtim.tv_nsec;
+  state.header.lib_file_offset = file_offset;
+
+  int relro_fd = TEMP_FAILURE_RETRY(open(state.path.c_str(), O_RDONLY | O_CLOEXEC));
+  if (relro_fd == -1) {
+    LD_DEBUG(any, "[ no shared RELRO file \"%s\"; will write one ]", state.path.c_str());
+    return false;
+  }
+  if (!is_trusted_file(relro_fd, state.path)) {
+    // Leave the file alone rather than fighting over it with whoever owns it.
+    close(relro_fd);
+    g_shared_relro_states.erase(si);
+    return false;
+  }
+  SharedRelroHeader header;
+  if (!read_header(relro_fd, &header) ||
+      memcmp(header.boot_id, state.header.boot_id, sizeof(header.boot_id)) != 0 ||
+      header.lib_dev != state.header.lib_dev ||
+      header.lib_ino != state.header.lib_ino || header.lib_size != state.header.lib_size ||
+      header.lib_mtime_ns != state.header.lib_mtime_ns ||
+      header.lib_file_offset != state.header.lib_file_offset) {
+    LD_DEBUG(any, "[ shared RELRO file \"%s\" is stale; will rewrite it ]", state.path.c_str());
+    close(relro_fd);
+    return false;
+  }
+
+  // Only share the file if the library can go where it was recorded. Otherwise another process
+  // may well be using the file successfully, so leave it alone.
+  void* hint = reinterpret_cast<void*>(static_cast<uintptr_t>(header.load_start));
+  size_t size = header.load_size;
+  void* start = mmap(hint, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE,
+                     -1, 0);
+  if (start != hint) {
+    if (start != MAP_FAILED) {
+      // Kernels before 4.17 treat MAP_FIXED_NOREPLACE as a hint.
+      munmap(start, size);
+    }
+    LD_DEBUG(any, "[ can't load \"%s\" at %p for shared RELRO file \"%s\" ]", si->get_realpath(),
+             hint, state.path.c_str());
+    close(relro_fd);
+    g_shared_relro_states.erase(si);
+    return false;
+  }
+
+  state.header = header;
+  state.fd = relro_fd;
+  state.reserved_start = start;
+  state.reserved_size = size;
+  address_space->start_addr = start;
+  address_space->reserved_size = size;
+  address_space->must_use_address = false;
+  return true;
+}
+
+void shared_relro_loaded(soinfo* si) {
+  auto it = g_shared_relro_states.find(si);
+  if (it == g_shared_relro_states.end() || it->second.reserved_start == nullptr) {
+    return;
+  }
+  SharedRelroState& state = it->second;
+  if (si->base != reinterpret_cast<ElfW(Addr)>(state.reserved_start) ||
+      si->size != state.reserved_size) {
+    // The library didn't fit the reservation (it was loaded elsewhere).
+    munmap(state.reserved_start, state.reserved_size);
+    close(state.fd);
+    g_shared_relro_states.erase(it);
+    return;
+  }
+  // The linker reserved this address space itself, so it is unmapped when the library is.
+  si->set_mapped_by_caller(false);
+  state.reserved_start = nullptr;
+  state.reserved_size = 0;
+}
+
+static void write_relro_file(soinfo* si, SharedRelroState* state) {
+  state->header.load_start = si->base;
+  state->header.load_size = si->size;
+
+  // Write to a temporary file and rename it into place so that a concurrently starting process
+  // never sees a partial file. The file has to be readable as well since serializing the RELRO
+  // segment also maps it over the segment. Other uids can only use a file written by root (see
+  // is_trusted_file), so only root's files need to be readable by them.
+  std::string tmp_path = android::base::StringPrintf("%s.%d", state->path.c_str(), getpid());
+  mode_t mode = (geteuid() == 0) ? 0644 : 0600;
+  unlink(tmp_path.c_str());
+  int fd = TEMP_FAILURE_RETRY(
+      open(tmp_path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_TRUNC | O_CLOEXEC, mode));
+  if (fd == -1) {
+    LD_DEBUG(any, "[ couldn't create shared RELRO file \"%s\": %m ]", tmp_path.c_str());
+    return;
+  }
+  size_t relro_offset = page_size();
+  bool ok = TEMP_FAILURE_RETRY(write(fd, &state->header, sizeof(state->header))) ==
+                static_cast<ssize_t>(sizeof(state->header)) &&
+            TEMP_FAILURE_RETRY(lseek64(fd, relro_offset, SEEK_SET)) ==
+                static_cast<off64_t>(relro_offset) &&
+            phdr_table_serialize_gnu_relro(si->phdr, si->phnum, si->load_bias, fd,
+                                           &relro_offset) == 0;
+  close(fd);
+  if (!ok || rename(tmp_path.c_str(), state->path.c_str()) == -1) {
+    LD_DEBUG(any, "[ couldn't write shared RELRO file \"%s\": %m ]", state->path.c_str());
+    unlink(tmp_path.c_str());
+    return;
+  }
+  LD_DEBUG(any, "[ wrote shared RELRO file \"%s\" for \"%s\" ]", state->path.c_str(),
+           si->get_realpath());
+}
+
+void shared_relro_linked(soinfo* si) {
+  auto it = g_shared_relro_states.find(si);
+  if (it == g_shared_relro_states.end()) {
+    return;
+  }
+  SharedRelroState& state = it->second;
+  // In 16KiB app compat mode the RELRO segment isn't where the program headers say, and with
+  // MTE globals tagging it is different in every process anyway.
+  if (!si->should_use_16kib_app_compat() && !si->should_tag_memtag_globals()) {
+    if (state.fd == -1) {
+      write_relro_file(si, &state);
+    } else {
+      size_t relro_offset = page_size();
+      if (phdr_table_map_gnu_relro(si->phdr, si->phnum, si->load_bias, state.fd,
+                                   &relro_offset) == 0) {
+        LD_DEBUG(any, "[ mapped shared RELRO file \"%s\" for \"%s\" ]", state.path.c_str(),
+                 si->get_realpath());
+      } else {
+        LD_DEBUG(any, "[ couldn't map shared RELRO file \"%s\": %m ]", state.path.c_str());
+      }
+    }
+  }
+  if (state.fd != -1) {
+    close(state.fd);
+  }
+  g_shared_relro_states.erase(it);
+}
+
+void shared_relro_forget(soinfo* si) {
+  auto it = g_shared_relro_states.find(si);
+  if (it == g_shared_relro_states.end()) {
+    return;
+  }
+  SharedRelroState& state = it->second;
+  if (state.reserved_start != nullptr) {
+    munmap(state.reserved_start, state.reserved_size);
+  }
+  if (state.fd != -1) {
+    close(state.fd);
+  }
+  g_shared_relro_states.erase(it);
+}
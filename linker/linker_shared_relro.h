@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <sys/types.h>
+
+struct address_space_params;
+struct soinfo;
+
+// Linker-managed RELRO sharing between processes.
+//
+// ld.config.txt can list libraries of a namespace whose RELRO segments should be shared:
+//
+//   namespace.<name>.shared_relro.libs = libfoo.so:libbar.so
+//   namespace.<name>.shared_relro.dir = /data/misc/shared_relro/${LIB}
+//   namespace.<name>.shared_relro.fixed_address = true
+//
+// The first process to load such a library serializes its relocated RELRO segment into
+// <dir>/<file name>.relro, recording where the library was loaded. Later processes try to load
+// the library at the same address and then replace every RELRO page that came out identical
+// with a mapping of the file (see phdr_table_map_gnu_relro), so those pages are shared instead
+// of being dirty in every process. This is the mechanism android_dlopen_ext offers through
+// ANDROID_DLEXT_WRITE_RELRO/ANDROID_DLEXT_USE_RELRO, without the caller having to manage the
+// address space and the file descriptor itself.
+//
+// Sharing is best effort: if the recorded address is taken, or the library file changed, the
+// library is loaded normally. The directory must only be writable by trusted processes, and a
+// file is only used if it is owned by root or the loader's effective uid and isn't writable by
+// anyone else, since its pages stay mapped over the library's GOT.
+//
+// Loading at the recorded address means these libraries don't get a new random address in each
+// process, which is why the config has to opt in with shared_relro.fixed_address. A file is only
+// used during the boot that wrote it, so the first process after each boot still gets a random
+// address, and everyone else shares it.
+
+// Called before `si` is mapped from `fd`. Returns true and fills in `address_space` if `si`
+// should be loaded at the address recorded in its RELRO file.
+bool shared_relro_reserve(soinfo* si, int fd, off64_t file_offset,
+                          address_space_params* address_space);
+
+// Called after `si` was mapped.
+void shared_relro_loaded(soinfo* si);
+
+// Called after `si` was relocated and its RELRO segment protected. Maps the shared RELRO pages,
+// or writes the RELRO file if there was no usable one.
+void shared_relro_linked(soinfo* si);
+
+// Called when `si` is freed (whether or not it was loaded successfully).
+void shared_relro_forget(soinfo* si);
@@ -43,6 +43,14 @@ class sleb128_decoder {
       : current_(buffer), end_(buffer+count) { }
 
   size_t pop_front() {
+    // Most values in packed relocations (offset deltas, and r_info and addends that are repeated
+    // within a group) fit in a single byte, so decode those without entering the loop.
+    if (__predict_true(current_ < end_ && (*current_ & 128) == 0)) {
+      uint8_t byte = *current_++;
+      // Sign-extend the 7-bit value.
+      return (byte & 64) ? static_cast<size_t>(byte) - 128 : byte;
+    }
+
     size_t value = 0;
     static const size_t size = CHAR_BIT * sizeof(value);
 
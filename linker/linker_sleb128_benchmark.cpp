@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "linker_sleb128.h"
+
+static void append_sleb128(std::vector<uint8_t>* out, int64_t value) {
+  bool more;
+  do {
+    uint8_t byte = value & 127;
+    value >>= 7;
+    more = !((value == 0 && (byte & 64) == 0) || (value == -1 && (byte & 64) != 0));
+    out->push_back(byte | (more ? 128 : 0));
+  } while (more);
+}
+
+// Decodes a stream of values where the given percentage need more than one byte. Offset deltas
+// in packed relocations are almost always single bytes; r_info and addends often aren't.
+static void BM_sleb128_decode(benchmark::State& state) {
+  constexpr size_t kValueCount = 64 * 1024;
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<int> percent(0, 99);
+  std::uniform_int_distribution<int64_t> small(-64, 63);
+  std::uniform_int_distribution<int64_t> large(-(int64_t(1) << 30), int64_t(1) << 30);
+  std::vector<uint8_t> encoding;
+  for (size_t i = 0; i < kValueCount; ++i) {
+    append_sleb128(&encoding, percent(rng) < state.range(0) ? large(rng) : small(rng));
+  }
+
+  for (auto _ : state) {
+    sleb128_decoder decoder(encoding.data(), encoding.size());
+    size_t sum = 0;
+    for (size_t i = 0; i < kValueCount; ++i) {
+      sum += decoder.pop_front();
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * kValueCount);
+  state.SetBytesProcessed(state.iterations() * encoding.size());
+}
+
+BENCHMARK(BM_sleb128_decode)->Arg(0)->Arg(10)->Arg(50)->Arg(100);
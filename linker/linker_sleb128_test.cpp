@@ -108,3 +108,15 @@ TEST(linker_sleb128, smoke) {
   EXPECT_EQ(static_cast<uint64_t>(-9223372036854775807LL - 1), decoder.pop_front());
 #endif
 }
+
+TEST(linker_sleb128, single_byte) {
+  // Every one-byte encoding, which the decoder handles without its loop.
+  std::vector<uint8_t> encoding;
+  for (int value = -64; value < 64; ++value) {
+    encoding.push_back(static_cast<uint8_t>(value) & 127);
+  }
+  sleb128_decoder decoder(&encoding[0], encoding.size());
+  for (int value = -64; value < 64; ++value) {
+    EXPECT_EQ(static_cast<size_t>(static_cast<ssize_t>(value)), decoder.pop_front()) << value;
+  }
+}
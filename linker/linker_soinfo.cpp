@@ -34,6 +34,8 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
+
 #include <async_safe/log.h>
 
 #include "linker.h"
@@ -42,13 +44,15 @@
 #include "linker_globals.h"
 #include "linker_gnu_hash.h"
 #include "linker_logger.h"
+#include "linker_profile.h"
 #include "linker_relocate.h"
 #include "linker_utils.h"
 #include "platform/bionic/mte.h"
 #include "private/bionic_globals.h"
 
 SymbolLookupList::SymbolLookupList(soinfo* si)
-    : sole_lib_(si->get_lookup_lib()), begin_(&sole_lib_), end_(&sole_lib_ + 1) {
+    : sole_lib_(si->get_lookup_lib(&sole_filter_)), begin_(&sole_lib_), end_(&sole_lib_ + 1),
+      filters_begin_(&sole_filter_) {
   CHECK(si != nullptr);
   slow_path_count_ += !!g_linker_debug_config.lookup;
   slow_path_count_ += sole_lib_.needs_sysv_lookup();
@@ -57,22 +61,24 @@ SymbolLookupList::SymbolLookupList(soinfo* si)
 SymbolLookupList::SymbolLookupList(const soinfo_list_t& global_group, const soinfo_list_t& local_group) {
   slow_path_count_ += !!g_linker_debug_config.lookup;
   libs_.reserve(1 + global_group.size() + local_group.size());
+  filters_.reserve(libs_.capacity());
 
   // Reserve a space in front for DT_SYMBOLIC lookup.
   libs_.push_back(SymbolLookupLib {});
+  filters_.push_back(SymbolLookupFilter {});
 
-  global_group.for_each([this](soinfo* si) {
-    libs_.push_back(si->get_lookup_lib());
-    slow_path_count_ += libs_.back().needs_sysv_lookup();
-  });
-
-  local_group.for_each([this](soinfo* si) {
-    libs_.push_back(si->get_lookup_lib());
-    slow_path_count_ += libs_.back().needs_sysv_lookup();
-  });
+  global_group.for_each([this](soinfo* si) { add_lib(si); });
+  local_group.for_each([this](soinfo* si) { add_lib(si); });
 
   begin_ = &libs_[1];
   end_ = &libs_[0] + libs_.size();
+  filters_begin_ = &filters_[1];
+}
+
+void SymbolLookupList::add_lib(soinfo* si) {
+  filters_.emplace_back();
+  libs_.push_back(si->get_lookup_lib(&filters_.back()));
+  slow_path_count_ += libs_.back().needs_sysv_lookup();
 }
 
 /* "This element's presence in a shared object library alters the dynamic linker's
@@ -89,9 +95,11 @@ SymbolLookupList::SymbolLookupList(const soinfo_list_t& global_group, const soin
 void SymbolLookupList::set_dt_symbolic_lib(soinfo* lib) {
   CHECK(!libs_.empty());
   slow_path_count_ -= libs_[0].needs_sysv_lookup();
-  libs_[0] = lib ? lib->get_lookup_lib() : SymbolLookupLib();
+  filters_[0] = SymbolLookupFilter();
+  libs_[0] = lib ? lib->get_lookup_lib(&filters_[0]) : SymbolLookupLib();
   slow_path_count_ += libs_[0].needs_sysv_lookup();
   begin_ = lib ? &libs_[0] : &libs_[1];
+  filters_begin_ = lib ? &filters_[0] : &filters_[1];
 }
 
 // Check whether a requested version matches the version on a symbol definition. There are a few
@@ -111,10 +119,70 @@ static inline bool check_symbol_version(const ElfW(Versym)* ver_table, uint32_t
       verneed == (verdef & ~kVersymHiddenBit);
 }
 
-template <bool IsGeneral>
+// Search a library's GNU hash chain, starting at sym_idx, for a matching symbol definition.
+static inline const ElfW(Sym)* gnu_chain_lookup(const SymbolLookupLib* lib, uint32_t sym_idx,
+                                                const char* name, uint32_t hash,
+                                                uint32_t name_len, const version_info* vi) {
+  ElfW(Versym) verneed = kVersymNotNeeded;
+  bool calculated_verneed = false;
+
+  uint32_t chain_value = 0;
+  const ElfW(Sym)* sym = nullptr;
+
+  do {
+    sym = lib->symtab_ + sym_idx;
+    chain_value = lib->gnu_chain_[sym_idx];
+    if ((chain_value >> 1) == (hash >> 1)) {
+      if (vi != nullptr && !calculated_verneed) {
+        calculated_verneed = true;
+        verneed = find_verdef_version_index(lib->si_, vi);
+      }
+      if (check_symbol_version(lib->versym_, sym_idx, verneed) &&
+          static_cast<size_t>(sym->st_name) + name_len + 1 <= lib->strtab_size_ &&
+          memcmp(lib->strtab_ + sym->st_name, name, name_len + 1) == 0 &&
+          is_symbol_global_and_defined(lib->si_, sym)) {
+        return sym;
+      }
+    }
+    ++sym_idx;
+  } while ((chain_value & 1) == 0);
+
+  return nullptr;
+}
+
+// The fast path: every library in the list has a GNU hash table. Test the Bloom filters several
+// libraries at a time and only walk the hash chains of the candidates, in lookup order.
 __attribute__((noinline)) static const ElfW(Sym)*
-soinfo_do_lookup_impl(const char* name, const version_info* vi,
-                      soinfo** si_found_in, const SymbolLookupList& lookup_list) {
+soinfo_do_lookup_gnu(const char* name, const version_info* vi,
+                     soinfo** si_found_in, const SymbolLookupList& lookup_list) {
+  const auto [ hash, name_len ] = calculate_gnu_hash(name);
+  const SymbolLookupLib* libs = lookup_list.begin();
+  const SymbolLookupFilter* filters = lookup_list.filters();
+  const size_t lib_count = lookup_list.end() - libs;
+
+  for (size_t batch = 0; batch < lib_count; batch += kGnuBloomBatchSize) {
+    const size_t count = std::min<size_t>(lib_count - batch, kGnuBloomBatchSize);
+    uint32_t candidates = gnu_bloom_test_batch(filters + batch, count, hash);
+    while (candidates != 0) {
+      const SymbolLookupLib* lib = libs + batch + __builtin_ctz(candidates);
+      candidates &= candidates - 1;
+
+      const uint32_t sym_idx = lib->gnu_bucket_[hash % lib->gnu_nbucket_];
+      if (sym_idx == 0) continue;
+
+      if (const ElfW(Sym)* sym = gnu_chain_lookup(lib, sym_idx, name, hash, name_len, vi)) {
+        *si_found_in = lib->si_;
+        return sym;
+      }
+    }
+  }
+  return nullptr;
+}
+
+// The general path, for lists with SysV-hash-only libraries.
+__attribute__((noinline)) static const ElfW(Sym)*
+soinfo_do_lookup_general(const char* name, const version_info* vi,
+                         soinfo** si_found_in, const SymbolLookupList& lookup_list) {
   const auto [ hash, name_len ] = calculate_gnu_hash(name);
   constexpr uint32_t kBloomMaskBits = sizeof(ElfW(Addr)) * 8;
   SymbolName elf_symbol_name(name);
@@ -132,7 +200,7 @@ soinfo_do_lookup_impl(const char* name, const version_info* vi,
       if (it == end) return nullptr;
       lib = it++;
 
-      if (IsGeneral && lib->needs_sysv_lookup()) {
+      if (lib->needs_sysv_lookup()) {
         if (const ElfW(Sym)* sym = lib->si_->find_symbol_by_name(elf_symbol_name, vi)) {
           *si_found_in = lib->si_;
           return sym;
@@ -140,15 +208,14 @@ soinfo_do_lookup_impl(const char* name, const version_info* vi,
         continue;
       }
 
-      if (IsGeneral) {
-        LD_DEBUG(lookup, "SEARCH %s in %s@%p (gnu)",
-                 name, lib->si_->get_realpath(), reinterpret_cast<void*>(lib->si_->base));
-      }
+      LD_DEBUG(lookup, "SEARCH %s in %s@%p (gnu)",
+               name, lib->si_->get_realpath(), reinterpret_cast<void*>(lib->si_->base));
 
-      const uint32_t word_num = (hash / kBloomMaskBits) & lib->gnu_maskwords_;
-      const ElfW(Addr) bloom_word = lib->gnu_bloom_filter_[word_num];
+      const SymbolLookupFilter* filter = lookup_list.filters() + (lib - lookup_list.begin());
+      const uint32_t word_num = (hash / kBloomMaskBits) & filter->gnu_maskwords_;
+      const ElfW(Addr) bloom_word = filter->gnu_bloom_filter_[word_num];
       const uint32_t h1 = hash % kBloomMaskBits;
-      const uint32_t h2 = (hash >> lib->gnu_shift2_) % kBloomMaskBits;
+      const uint32_t h2 = (hash >> filter->gnu_shift2_) % kBloomMaskBits;
 
       if ((1 & (bloom_word >> h1) & (bloom_word >> h2)) == 1) {
         sym_idx = lib->gnu_bucket_[hash % lib->gnu_nbucket_];
@@ -159,38 +226,18 @@ soinfo_do_lookup_impl(const char* name, const version_info* vi,
     }
 
     // Search the library's hash table chain.
-    ElfW(Versym) verneed = kVersymNotNeeded;
-    bool calculated_verneed = false;
-
-    uint32_t chain_value = 0;
-    const ElfW(Sym)* sym = nullptr;
-
-    do {
-      sym = lib->symtab_ + sym_idx;
-      chain_value = lib->gnu_chain_[sym_idx];
-      if ((chain_value >> 1) == (hash >> 1)) {
-        if (vi != nullptr && !calculated_verneed) {
-          calculated_verneed = true;
-          verneed = find_verdef_version_index(lib->si_, vi);
-        }
-        if (check_symbol_version(lib->versym_, sym_idx, verneed) &&
-            static_cast<size_t>(sym->st_name) + name_len + 1 <= lib->strtab_size_ &&
-            memcmp(lib->strtab_ + sym->st_name, name, name_len + 1) == 0 &&
-            is_symbol_global_and_defined(lib->si_, sym)) {
-          *si_found_in = lib->si_;
-          return sym;
-        }
-      }
-      ++sym_idx;
-    } while ((chain_value & 1) == 0);
+    if (const ElfW(Sym)* sym = gnu_chain_lookup(lib, sym_idx, name, hash, name_len, vi)) {
+      *si_found_in = lib->si_;
+      return sym;
+    }
   }
 }
 
 const ElfW(Sym)* soinfo_do_lookup(const char* name, const version_info* vi,
                                   soinfo** si_found_in, const SymbolLookupList& lookup_list) {
   return lookup_list.needs_slow_path() ?
-      soinfo_do_lookup_impl<true>(name, vi, si_found_in, lookup_list) :
-      soinfo_do_lookup_impl<false>(name, vi, si_found_in, lookup_list);
+      soinfo_do_lookup_general(name, vi, si_found_in, lookup_list) :
+      soinfo_do_lookup_gnu(name, vi, si_found_in, lookup_list);
 }
 
 soinfo::soinfo(android_namespace_t* ns, const char* realpath, const struct stat* file_stat,
@@ -210,6 +257,8 @@ soinfo::soinfo(android_namespace_t* ns, const char* realpath, const struct stat*
 
   this->rtld_flags_ = rtld_flags;
   this->primary_namespace_ = ns;
+  // This soinfo may reuse the address of one that was freed.
+  invalidate_namespace_access_cache();
 }
 
 soinfo::~soinfo() {
@@ -259,19 +308,19 @@ size_t soinfo::get_verdef_cnt() const {
   return is_lp64_or_has_min_version(2) ? verdef_cnt_ : 0;
 }
 
-SymbolLookupLib soinfo::get_lookup_lib() {
+SymbolLookupLib soinfo::get_lookup_lib(SymbolLookupFilter* filter) {
   SymbolLookupLib result {};
   result.si_ = this;
 
-  // For libs that only have SysV hashes, leave the gnu_bloom_filter_ field NULL to signal that
-  // the fallback code path is needed.
+  // For libs that only have SysV hashes, leave the gnu_bucket_ field NULL to signal that the
+  // fallback code path is needed. The filter is left empty too: nothing reads it.
   if (!is_gnu_hash()) {
     return result;
   }
 
-  result.gnu_maskwords_ = gnu_maskwords_;
-  result.gnu_shift2_ = gnu_shift2_;
-  result.gnu_bloom_filter_ = gnu_bloom_filter_;
+  filter->gnu_bloom_filter_ = gnu_bloom_filter_;
+  filter->gnu_maskwords_ = gnu_maskwords_;
+  filter->gnu_shift2_ = gnu_shift2_;
 
   result.strtab_ = strtab_;
   result.strtab_size_ = strtab_size_;
@@ -460,9 +509,9 @@ void soinfo::call_pre_init_constructors() {
   call_array("DT_PREINIT_ARRAY", preinit_array_, preinit_array_count_, false, get_realpath());
 }
 
-void soinfo::call_constructors() {
+bool soinfo::claim_constructors() {
   if (constructors_called) {
-    return;
+    return false;
   }
 
   // We set constructors_called before actually calling the constructors, otherwise it doesn't
@@ -481,22 +530,62 @@ void soinfo::call_constructors() {
     // The GNU dynamic linker silently ignores these, but we warn the developer.
     DL_WARN("\"%s\": ignoring DT_PREINIT_ARRAY in shared library!", get_realpath());
   }
+  return true;
+}
+
+void soinfo::call_constructors() {
+  if (!claim_constructors()) {
+    return;
+  }
 
   get_children().for_each([] (soinfo* si) {
     si->call_constructors();
   });
 
-  if (!is_linker()) {
-    bionic_trace_begin((std::string("calling constructors: ") + get_realpath()).c_str());
+  LinkerProfile* profile = linker_profile_for(this);
+  if (is_linker()) {
+    run_constructors(nullptr, profile);
+  } else {
+    run_constructors((std::string("calling constructors: ") + get_realpath()).c_str(), profile);
   }
+  if (profile != nullptr) {
+    linker_profile_report(this);
+  }
+}
+
+void soinfo::collect_unfinished_constructors(std::vector<soinfo*>* order,
+                                             std::vector<soinfo*>* visited) {
+  if (constructors_finished() ||
+      std::find(visited->begin(), visited->end(), this) != visited->end()) {
+    return;
+  }
+  visited->push_back(this);
+
+  get_children().for_each([order, visited] (soinfo* si) {
+    si->collect_unfinished_constructors(order, visited);
+  });
+
+  order->push_back(this);
+}
+
+void soinfo::run_constructors(const char* trace_message, LinkerProfile* profile) {
+  if (trace_message != nullptr) {
+    bionic_trace_begin(trace_message);
+  }
+  uint64_t start_ns = profile != nullptr ? linker_profile_now_ns() : 0;
 
   // DT_INIT should be called before DT_INIT_ARRAY if both are present.
   call_function("DT_INIT", init_func_, get_realpath());
   call_array("DT_INIT_ARRAY", init_array_, init_array_count_, false, get_realpath());
 
-  if (!is_linker()) {
+  if (profile != nullptr) {
+    profile->constructors_ns = linker_profile_now_ns() - start_ns;
+  }
+  if (trace_message != nullptr) {
     bionic_trace_end();
   }
+
+  constructors_finished_.store(true, std::memory_order_release);
 }
 
 void soinfo::call_destructors() {
@@ -517,6 +606,7 @@ void soinfo::add_child(soinfo* child) {
   if (is_lp64_or_has_min_version(0)) {
     child->parents_.push_back(this);
     this->children_.push_back(child);
+    invalidate_namespace_access_cache();
   }
 }
 
@@ -552,6 +642,8 @@ void soinfo::remove_all_links() {
   parents_.clear();
   children_.clear();
   secondary_namespaces_.clear();
+
+  invalidate_namespace_access_cache();
 }
 
 dev_t soinfo::get_st_dev() const {
@@ -652,6 +744,7 @@ android_namespace_t* soinfo::get_primary_namespace() {
 void soinfo::add_secondary_namespace(android_namespace_t* secondary_ns) {
   CHECK(is_lp64_or_has_min_version(3));
   secondary_namespaces_.push_back(secondary_ns);
+  invalidate_namespace_access_cache();
 }
 
 android_namespace_list_t& soinfo::get_secondary_namespaces() {
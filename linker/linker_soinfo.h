@@ -30,6 +30,7 @@
 
 #include <link.h>
 
+#include <atomic>
 #include <list>
 #include <memory>
 #include <string>
@@ -77,12 +78,18 @@ ElfW(Addr) call_ifunc_resolver(ElfW(Addr) resolver_addr);
 typedef void (*linker_dtor_function_t)();
 typedef void (*linker_ctor_function_t)(int, char**, char**);
 
-// An entry within a SymbolLookupList.
-struct SymbolLookupLib {
+// The GNU Bloom filter of an entry within a SymbolLookupList. Most libraries in a list are
+// rejected by their filter alone, so SymbolLookupList keeps the filters in an array of their own,
+// parallel to the SymbolLookupLib array: a lookup then reads four (LP64) or five (ILP32) filters
+// per cache line and only touches the SymbolLookupLib of a candidate.
+struct SymbolLookupFilter {
+  ElfW(Addr)* gnu_bloom_filter_ = nullptr;
   uint32_t gnu_maskwords_ = 0;
   uint32_t gnu_shift2_ = 0;
-  ElfW(Addr)* gnu_bloom_filter_ = nullptr;
+};
 
+// An entry within a SymbolLookupList.
+struct SymbolLookupLib {
   const char* strtab_;
   size_t strtab_size_;
   const ElfW(Sym)* symtab_;
@@ -94,17 +101,23 @@ struct SymbolLookupLib {
 
   soinfo* si_ = nullptr;
 
-  bool needs_sysv_lookup() const { return si_ != nullptr && gnu_bloom_filter_ == nullptr; }
+  bool needs_sysv_lookup() const { return si_ != nullptr && gnu_bucket_ == nullptr; }
 };
 
 // A list of libraries to search for a symbol.
 class SymbolLookupList {
   std::vector<SymbolLookupLib> libs_;
+  std::vector<SymbolLookupFilter> filters_;
+  // Filled in by sole_lib_'s initializer, so it must be declared first.
+  SymbolLookupFilter sole_filter_;
   SymbolLookupLib sole_lib_;
   const SymbolLookupLib* begin_;
   const SymbolLookupLib* end_;
+  const SymbolLookupFilter* filters_begin_;
   size_t slow_path_count_ = 0;
 
+  void add_lib(soinfo* si);
+
  public:
   explicit SymbolLookupList(soinfo* si);
   SymbolLookupList(const soinfo_list_t& global_group, const soinfo_list_t& local_group);
@@ -112,6 +125,8 @@ class SymbolLookupList {
 
   const SymbolLookupLib* begin() const { return begin_; }
   const SymbolLookupLib* end() const { return end_; }
+  // The Bloom filters of [begin(), end()), in the same order.
+  const SymbolLookupFilter* filters() const { return filters_begin_; }
   bool needs_slow_path() const { return slow_path_count_ > 0; }
 };
 
@@ -149,6 +164,8 @@ struct version_info {
 // TODO(dimitry): remove reference from soinfo member functions to this class.
 class VersionTracker;
 
+struct LinkerProfile;
+
 struct soinfo_tls {
   TlsSegment segment;
   size_t module_id = kTlsUninitializedModuleId;
@@ -248,8 +265,22 @@ struct soinfo {
   ~soinfo();
 
   void call_constructors();
+  // Appends this library and those of its dependencies whose constructors haven't finished to
+  // `order`, once each and in the order call_constructors() would run them. Nothing is marked as
+  // called; `visited` tracks the libraries already walked.
+  void collect_unfinished_constructors(std::vector<soinfo*>* order, std::vector<soinfo*>* visited);
+  // Marks the constructors of this library as called. Returns false if they already were, in
+  // which case the caller must not run them.
+  bool claim_constructors();
+  // Runs DT_INIT and DT_INIT_ARRAY of a library claimed with claim_constructors(). This doesn't
+  // allocate, so dlopen() can call it without holding g_dl_mutex.
+  void run_constructors(const char* trace_message, LinkerProfile* profile);
   void call_destructors();
   void call_pre_init_constructors();
+  // True once the constructors of this library have run. Safe to read without g_dl_mutex.
+  bool constructors_finished() const {
+    return constructors_finished_.load(std::memory_order_acquire);
+  }
   bool prelink_image(bool deterministic_memtag_globals = false);
   bool link_image(const SymbolLookupList& lookup_list, soinfo* local_group_root,
                   const android_dlextinfo* extinfo, size_t* relro_fd_offset);
@@ -346,7 +377,7 @@ struct soinfo {
   void generate_handle();
   void* to_handle();
 
-  SymbolLookupLib get_lookup_lib();
+  SymbolLookupLib get_lookup_lib(SymbolLookupFilter* filter);
 
   void set_gap_start(ElfW(Addr) gap_start);
   ElfW(Addr) get_gap_start() const;
@@ -412,6 +443,11 @@ struct soinfo {
   void set_compat_relro_size(ElfW(Addr) size) { compat_relro_size_ = size; }
   ElfW(Addr) compat_relro_size() const { return compat_relro_start_; }
 
+  ElfW(Addr)* plt_got() const { return plt_got_; }
+  // True if the library has DT_AARCH64_VARIANT_PCS: some of its PLT calls don't preserve the
+  // registers a lazy binding trampoline is allowed to clobber.
+  bool has_variant_pcs() const { return has_variant_pcs_; }
+
  private:
   bool is_image_linked() const;
   void set_image_linked();
@@ -506,6 +542,13 @@ struct soinfo {
   // RELRO region for 16KiB compat loading
   ElfW(Addr) compat_relro_start_ = 0;
   ElfW(Addr) compat_relro_size_ = 0;
+
+  // Published after the constructors have run, for lookups that don't hold g_dl_mutex.
+  std::atomic<bool> constructors_finished_ = false;
+
+  // DT_PLTGOT, only used for lazy binding.
+  ElfW(Addr)* plt_got_ = nullptr;
+  bool has_variant_pcs_ = false;
 };
 
 // This function is used by dlvsym() to calculate hash of sym_ver
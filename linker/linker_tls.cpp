@@ -28,8 +28,13 @@
 
 #include "linker_tls.h"
 
+#include <algorithm>
 #include <vector>
 
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
 #include "async_safe/CHECK.h"
 #include "linker_globals.h"
 #include "linker_main.h"
@@ -44,6 +49,22 @@
 static bool g_static_tls_finished;
 static std::vector<TlsModule> g_tls_modules;
 
+#if defined(__x86_64__)
+// The size of the xsave area used by the x86-64 tlsdesc_resolver_dynamic slow path to preserve the
+// vector registers across the call to __tls_get_addr, or 0 if the OS hasn't enabled xsave (in
+// which case the resolver falls back to fxsave).
+extern "C" __LIBC_HIDDEN__ size_t tlsdesc_xsave_size;
+size_t tlsdesc_xsave_size;
+
+static void init_tlsdesc_xsave_size() {
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || (ecx & bit_OSXSAVE) == 0) return;
+  // Leaf 0xd, subleaf 0: ebx is the size needed for the features currently enabled in XCR0.
+  if (!__get_cpuid_count(0xd, 0, &eax, &ebx, &ecx, &edx)) return;
+  tlsdesc_xsave_size = ebx;
+}
+#endif
+
 static size_t get_unused_module_index() {
   for (size_t i = 0; i < g_tls_modules.size(); ++i) {
     if (g_tls_modules[i].soinfo_ptr == nullptr) {
@@ -83,14 +104,13 @@ static void register_tls_module(soinfo* si, size_t static_offset) {
   };
 }
 
+// The write lock on TlsModules must be held.
 static void unregister_tls_module(soinfo* si) {
-  ScopedSignalBlocker ssb;
-  ScopedWriteLock locker(&__libc_shared_globals()->tls_modules.rwlock);
-
   soinfo_tls* si_tls = si->get_tls();
   TlsModule& mod = g_tls_modules[__tls_module_id_to_idx(si_tls->module_id)];
   CHECK(mod.static_offset == SIZE_MAX);
   CHECK(mod.soinfo_ptr == si);
+  __free_tls_module_pool(mod);
   mod = {};
   si_tls->module_id = kTlsUninitializedModuleId;
 }
@@ -128,6 +148,10 @@ void linker_setup_exe_static_tls(const char* progname) {
   //  - http://b/118381796
   //  - https://github.com/golang/go/issues/29674
   __linker_reserve_bionic_tls_in_static_tls();
+
+#if defined(__x86_64__)
+  init_tlsdesc_xsave_size();
+#endif
 }
 
 void linker_finalize_static_tls() {
@@ -155,10 +179,21 @@ void register_soinfo_tls(soinfo* si) {
   register_tls_module(si, static_offset);
 }
 
-void unregister_soinfo_tls(soinfo* si) {
+static bool has_registered_tls(soinfo* si) {
   soinfo_tls* si_tls = si->get_tls();
-  if (si_tls == nullptr || si_tls->module_id == kTlsUninitializedModuleId) {
+  return si_tls != nullptr && si_tls->module_id != kTlsUninitializedModuleId;
+}
+
+void unregister_soinfo_tls(const std::vector<soinfo*>& sis) {
+  // Only block signals and take the lock once for the whole group, and not at all if none of the
+  // libraries has a TLS segment (the common case).
+  auto it = std::find_if(sis.begin(), sis.end(), has_registered_tls);
+  if (it == sis.end()) {
     return;
   }
-  return unregister_tls_module(si);
+  ScopedSignalBlocker ssb;
+  ScopedWriteLock locker(&__libc_shared_globals()->tls_modules.rwlock);
+  for (; it != sis.end(); ++it) {
+    if (has_registered_tls(*it)) unregister_tls_module(*it);
+  }
 }
@@ -30,6 +30,8 @@
 
 #include <stdlib.h>
 
+#include <vector>
+
 #include "private/bionic_elf_tls.h"
 
 struct TlsModule;
@@ -39,7 +41,7 @@ void linker_setup_exe_static_tls(const char* progname);
 void linker_finalize_static_tls();
 
 void register_soinfo_tls(soinfo* si);
-void unregister_soinfo_tls(soinfo* si);
+void unregister_soinfo_tls(const std::vector<soinfo*>& sis);
 
 const TlsModule& get_tls_module(size_t module_id);
 
@@ -17,6 +17,8 @@
 #include <dlfcn.h>
 #include <sys/stat.h>
 
+#include <regex>
+#include <string>
 #include <vector>
 
 #include <gtest/gtest.h>
@@ -146,6 +148,68 @@ TEST_F(cfi_test_DeathTest, basic) {
 #endif
 }
 
+// The shadow of libraries loaded together is written in one go. Each of them still has to send
+// checks for its own addresses to its own __cfi_check.
+TEST(cfi_test, closure) {
+#if defined(__BIONIC__)
+  void* handle = dlopen("libcfi-test-closure.so", RTLD_NOW | RTLD_LOCAL);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+
+  for (const char* name :
+       {"libcfi-test-closure.so", "libcfi-test-closure-dep1.so", "libcfi-test-closure-dep2.so"}) {
+    SCOPED_TRACE(name);
+    // dlsym() looks in the library itself before its dependencies.
+    void* lib = dlopen(name, RTLD_NOW | RTLD_NOLOAD);
+    ASSERT_TRUE(lib != nullptr) << dlerror();
+    auto get_count = reinterpret_cast<size_t (*)()>(dlsym(lib, "get_count"));
+    auto get_last_address = reinterpret_cast<void* (*)()>(dlsym(lib, "get_last_address"));
+    auto get_global_address = reinterpret_cast<void* (*)()>(dlsym(lib, "get_global_address"));
+    auto bss = reinterpret_cast<char*>(dlsym(lib, "bss"));
+    ASSERT_TRUE(get_count != nullptr && get_last_address != nullptr &&
+                get_global_address != nullptr && bss != nullptr);
+
+    size_t c = get_count();
+    __cfi_slowpath(43, get_global_address());
+    EXPECT_EQ(get_global_address(), get_last_address());
+    EXPECT_EQ(++c, get_count());
+
+    for (size_t i = 0; i < 1024 * 1024; i += CFIShadow::kCfiCheckAlign) {
+      __cfi_slowpath(47, bss + i);
+      EXPECT_EQ(bss + i, get_last_address());
+      EXPECT_EQ(++c, get_count());
+    }
+    dlclose(lib);
+  }
+
+  dlclose(handle);
+#endif
+}
+
+// LD_DEBUG=statistics reports how many shadow writes were applied, and with how many remaps of
+// the shadow. Without batching, there would be one remap per write.
+TEST(cfi_test, closure_batched) {
+#if defined(__BIONIC__)
+  std::string helper = GetTestLibRoot() + "/cfi_test_closure_helper";
+  ExecTestHelper eth;
+  eth.SetArgs({ helper.c_str(), nullptr });
+  eth.SetEnv({ "LD_DEBUG=statistics", nullptr });
+  eth.Run([&]() { execve(helper.c_str(), eth.GetArgs(), eth.GetEnv()); }, 0,
+          "CFI shadow: \\d+ writes applied");
+
+  size_t writes = 0;
+  size_t remaps = 0;
+  std::regex stats(R"(CFI shadow: (\d+) writes applied with (\d+) remaps)");
+  std::string output = eth.GetOutput();
+  for (std::sregex_iterator it(output.begin(), output.end(), stats), end; it != end; ++it) {
+    writes = std::stoul((*it)[1]);
+    remaps = std::stoul((*it)[2]);
+  }
+  // Three libraries are loaded and unloaded.
+  ASSERT_GE(writes, 6U) << output;
+  ASSERT_LT(remaps, writes) << output;
+#endif
+}
+
 TEST(cfi_test, invalid) {
 #if defined(__BIONIC__)
   void* handle;
@@ -360,6 +360,102 @@ TEST(dl, disable_ld_config_file) {
 #endif
 }
 
+// Runs lazy_bind_test_helper with its library bound lazily. The library calls functions taking
+// integer, floating-point and vector arguments through its PLT, and checks that they see the same
+// arguments on the first call (through the lazy binding trampoline) as on the second.
+TEST(dl, lazy_bind) {
+#if defined(__BIONIC__)
+  std::string helper = GetTestLibRoot() + "/lazy_bind_test_helper";
+  ExecTestHelper eth;
+  eth.SetArgs({ helper.c_str(), nullptr });
+  eth.SetEnv({ "LD_BIND_LAZY=liblazy_bind_test_caller.so", nullptr });
+  eth.Run([&]() { execve(helper.c_str(), eth.GetArgs(), eth.GetEnv()); }, 0, "^ok\n$");
+#else
+  GTEST_SKIP() << "LD_BIND_LAZY is bionic only";
+#endif
+}
+
+// Runs concurrent_constructors_test_helper with concurrent_constructors enabled. Two threads
+// dlopen() a library each whose constructor waits for the other's, which only works if they run
+// at the same time. Then a constructor dlopen()s a sibling dependency whose constructor hasn't run
+// yet, and must get it back initialized.
+TEST(dl, exec_with_concurrent_constructors) {
+#if defined(__BIONIC__)
+  SKIP_WITH_HWASAN << "libclang_rt.hwasan is not found with custom ld config";
+  if (is_user_build()) {
+    GTEST_SKIP() << "LD_CONFIG_FILE is not supported on user build";
+  }
+  char default_search_paths[PATH_MAX];
+  android_get_LD_LIBRARY_PATH(default_search_paths, sizeof(default_search_paths));
+
+  TemporaryFile config_file;
+  std::ofstream fout(config_file.path, std::ios::out);
+  fout << "dir.test = " << GetTestLibRoot() << "/" << std::endl
+       << "[test]" << std::endl
+       << "namespace.default.search.paths = " << default_search_paths << ":" << GetTestLibRoot()
+       << std::endl
+       << "namespace.default.concurrent_constructors = true" << std::endl;
+  fout.close();
+
+  std::string helper = GetTestLibRoot() + "/concurrent_constructors_test_helper";
+  std::string env = std::string("LD_CONFIG_FILE=") + config_file.path;
+  ExecTestHelper eth;
+  eth.SetArgs({ helper.c_str(), nullptr });
+  eth.SetEnv({ env.c_str(), nullptr });
+  eth.Run([&]() { execve(helper.c_str(), eth.GetArgs(), eth.GetEnv()); }, 0,
+          "overlapped: yes\nsibling value: 42\n");
+#else
+  GTEST_SKIP() << "LD_CONFIG_FILE is bionic only";
+#endif
+}
+
+// Runs shared_relro_test_helper twice with libdlext_test.so opted in to shared RELRO. The second
+// process must find the file the first one wrote, load the library at the same address, and map
+// the file over its RELRO segment.
+TEST(dl, exec_with_shared_relro) {
+#if defined(__BIONIC__)
+  SKIP_WITH_HWASAN << "libclang_rt.hwasan is not found with custom ld config";
+  if (is_user_build()) {
+    GTEST_SKIP() << "LD_CONFIG_FILE is not supported on user build";
+  }
+  char default_search_paths[PATH_MAX];
+  android_get_LD_LIBRARY_PATH(default_search_paths, sizeof(default_search_paths));
+
+  TemporaryDir relro_dir;
+  TemporaryFile config_file;
+  std::ofstream fout(config_file.path, std::ios::out);
+  fout << "dir.test = " << GetTestLibRoot() << "/" << std::endl
+       << "[test]" << std::endl
+       << "namespace.default.search.paths = " << default_search_paths << ":" << GetTestLibRoot()
+       << std::endl
+       << "namespace.default.shared_relro.libs = libdlext_test.so" << std::endl
+       << "namespace.default.shared_relro.dir = " << relro_dir.path << std::endl
+       << "namespace.default.shared_relro.fixed_address = true" << std::endl;
+  fout.close();
+
+  std::string helper = GetTestLibRoot() + "/shared_relro_test_helper";
+  std::string env = std::string("LD_CONFIG_FILE=") + config_file.path;
+  std::string outputs[2];
+  for (std::string& output : outputs) {
+    ExecTestHelper eth;
+    eth.SetArgs({ helper.c_str(), nullptr });
+    eth.SetEnv({ env.c_str(), nullptr });
+    eth.Run([&]() { execve(helper.c_str(), eth.GetArgs(), eth.GetEnv()); }, 0, nullptr);
+    output = eth.GetOutput();
+  }
+  ASSERT_TRUE(std::regex_search(outputs[1], std::regex(" shared\n$"))) << outputs[1];
+  ASSERT_EQ(outputs[0], outputs[1]);
+
+  // The file must not be writable by anyone but its owner.
+  struct stat sb;
+  ASSERT_EQ(0, stat((std::string(relro_dir.path) + "/libdlext_test.so.relro").c_str(), &sb));
+  ASSERT_EQ(0U, sb.st_mode & (S_IWGRP | S_IWOTH));
+  ASSERT_EQ(geteuid(), sb.st_uid);
+#else
+  GTEST_SKIP() << "LD_CONFIG_FILE is bionic only";
+#endif
+}
+
 static void RelocationsTest(const char* lib, const char* expectation) {
 #if defined(__BIONIC__)
   // Does readelf think the .so file looks right?
@@ -24,6 +24,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <sys/cdefs.h>
+#include <sys/mman.h>
 #if __has_include(<sys/auxv.h>)
 #include <sys/auxv.h>
 #endif
@@ -217,6 +218,86 @@ TEST(dlfcn, dlopen_noload) {
   ASSERT_EQ(0, dlclose(handle2));
 }
 
+// A library that was already dlopen()ed by the same bare name is found without going through
+// the whole load. Those references have to be counted like any other.
+TEST(dlfcn, dlopen_loaded_refcount) {
+  void* handle = dlopen("libtest_simple.so", RTLD_NOW);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+  void* handle2 = dlopen("libtest_simple.so", RTLD_NOW);
+  ASSERT_TRUE(handle2 != nullptr) << dlerror();
+  ASSERT_EQ(handle, handle2);
+
+  ASSERT_EQ(0, dlclose(handle2));
+  ASSERT_TRUE(dlsym(handle, "dlopen_testlib_simple_func") != nullptr) << dlerror();
+  ASSERT_EQ(0, dlclose(handle));
+
+  ASSERT_TRUE(dlopen("libtest_simple.so", RTLD_NOW | RTLD_NOLOAD) == nullptr);
+}
+
+TEST(dlfcn, dlopen_loaded_dependency_outlives_parent) {
+  // libdlext_test.so is a DT_NEEDED of libtest_with_dependency.so, so all of them count towards
+  // the same group.
+  void* parent = dlopen("libtest_with_dependency.so", RTLD_NOW);
+  ASSERT_TRUE(parent != nullptr) << dlerror();
+  void* handle = dlopen("libdlext_test.so", RTLD_NOW);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+  void* handle2 = dlopen("libdlext_test.so", RTLD_NOW);
+  ASSERT_TRUE(handle2 != nullptr) << dlerror();
+  ASSERT_EQ(handle, handle2);
+
+  ASSERT_EQ(0, dlclose(parent));
+  ASSERT_EQ(0, dlclose(handle));
+
+  // The last reference keeps the dependency loaded.
+  auto fn = reinterpret_cast<int (*)()>(dlsym(handle2, "getRandomNumber"));
+  ASSERT_TRUE(fn != nullptr) << dlerror();
+  ASSERT_EQ(4, fn());
+
+  ASSERT_EQ(0, dlclose(handle2));
+  ASSERT_TRUE(dlopen("libdlext_test.so", RTLD_NOW | RTLD_NOLOAD) == nullptr);
+  ASSERT_TRUE(dlopen("libtest_with_dependency.so", RTLD_NOW | RTLD_NOLOAD) == nullptr);
+}
+
+TEST(dlfcn, dlopen_loaded_after_reload) {
+  void* handle = dlopen("libtest_simple.so", RTLD_NOW);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+  void* handle2 = dlopen("libtest_simple.so", RTLD_NOW);
+  ASSERT_TRUE(handle2 != nullptr) << dlerror();
+  void* sym = dlsym(handle, "dlopen_testlib_simple_func");
+  ASSERT_TRUE(sym != nullptr) << dlerror();
+  Dl_info info;
+  ASSERT_NE(0, dladdr(sym, &info));
+  void* old_base = info.dli_fbase;
+  ASSERT_EQ(0, dlclose(handle2));
+  ASSERT_EQ(0, dlclose(handle));
+  ASSERT_TRUE(dlopen("libtest_simple.so", RTLD_NOW | RTLD_NOLOAD) == nullptr);
+
+  // Keep the library from being loaded where it was before.
+  void* reserved = mmap(old_base, getpagesize(), PROT_NONE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+  auto unmap_guard = android::base::make_scope_guard([&] {
+    if (reserved != MAP_FAILED) munmap(reserved, getpagesize());
+  });
+
+  handle = dlopen("libtest_simple.so", RTLD_NOW);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+  handle2 = dlopen("libtest_simple.so", RTLD_NOW);
+  ASSERT_TRUE(handle2 != nullptr) << dlerror();
+  ASSERT_EQ(handle, handle2);
+
+  sym = dlsym(handle2, "dlopen_testlib_simple_func");
+  ASSERT_TRUE(sym != nullptr) << dlerror();
+  ASSERT_NE(0, dladdr(sym, &info));
+  if (reserved == old_base) {
+    ASSERT_NE(old_base, info.dli_fbase);
+  }
+  ASSERT_TRUE(reinterpret_cast<bool (*)()>(sym)());
+
+  ASSERT_EQ(0, dlclose(handle2));
+  ASSERT_EQ(0, dlclose(handle));
+  ASSERT_TRUE(dlopen("libtest_simple.so", RTLD_NOW | RTLD_NOLOAD) == nullptr);
+}
+
 TEST(dlfcn, dlopen_by_soname) {
   static const char* soname = "libdlext_test_soname.so";
   static const char* filename = "libdlext_test_different_soname.so";
@@ -27,12 +27,17 @@
  */
 
 #include <dlfcn.h>
+#include <errno.h>
 #include <link.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 #include <gtest/gtest.h>
 
 #include <string>
 #include <thread>
+#include <utility>
+#include <vector>
 
 #include "gtest_globals.h"
 #include "platform/bionic/tls.h"
@@ -132,6 +137,29 @@ TEST(elftls_dl, bump_local_vars) {
   }).join();
 }
 
+// Dynamic TLS blocks are recycled from exited threads to new ones. Each new
+// thread must still see the module's initial values.
+TEST(elftls_dl, dynamic_tls_reinitialized_for_new_threads) {
+  void* lib = dlopen("libtest_elftls_dynamic.so", RTLD_LOCAL | RTLD_NOW);
+  ASSERT_NE(nullptr, lib);
+
+  auto get_local_var1 = reinterpret_cast<int(*)()>(dlsym(lib, "get_local_var1"));
+  ASSERT_NE(nullptr, get_local_var1);
+  auto get_local_var2 = reinterpret_cast<int(*)()>(dlsym(lib, "get_local_var2"));
+  ASSERT_NE(nullptr, get_local_var2);
+  auto bump_local_vars = reinterpret_cast<int(*)()>(dlsym(lib, "bump_local_vars"));
+  ASSERT_NE(nullptr, bump_local_vars);
+
+  for (int i = 0; i < 8; ++i) {
+    std::thread([&] {
+      ASSERT_EQ(15, get_local_var1());
+      ASSERT_EQ(25, get_local_var2());
+      ASSERT_EQ(42, bump_local_vars());
+      ASSERT_EQ(44, bump_local_vars());
+    }).join();
+  }
+}
+
 extern "C" int* missing_weak_tls_addr();
 
 // The Bionic linker resolves a TPREL relocation to an unresolved weak TLS
@@ -149,9 +177,10 @@ TEST(elftls_dl, tprel_missing_weak) {
 // The behavior of accessing an unresolved weak TLS symbol using a dynamic TLS
 // relocation depends on which kind of implementation the target uses. With
 // TLSDESC, the result is NULL. With __tls_get_addr, the result is the
-// generation count (or maybe undefined behavior)? This test only tests TLSDESC.
+// generation count (or maybe undefined behavior)? This test only tests TLSDESC,
+// which libtest_elftls_dynamic.so also uses on x86_64 (-mtls-dialect=gnu2).
 TEST(elftls_dl, tlsdesc_missing_weak) {
-#if defined(__aarch64__) || defined(__riscv)
+#if defined(__aarch64__) || defined(__riscv) || defined(__x86_64__)
   void* lib = dlopen("libtest_elftls_dynamic.so", RTLD_LOCAL | RTLD_NOW);
   ASSERT_NE(nullptr, lib);
 
@@ -229,6 +258,78 @@ TEST(elftls_dl, dlclose_removes_entry) {
 #endif
 }
 
+// dlclose tears down a whole group of libraries with TLS at once. Afterwards, dl_iterate_phdr
+// mustn't report any of them, and none of their memory may still be mapped.
+TEST(elftls_dl, dlclose_group) {
+#if defined(__BIONIC__)
+  static const char* const kMembers[] = {
+    "libtest_elftls_dynamic_group.so",
+    "libtest_elftls_dynamic_filler_1.so",
+    "libtest_elftls_dynamic_filler_2.so",
+    "libtest_elftls_dynamic_filler_3.so",
+  };
+
+  void* lib = dlopen("libtest_elftls_dynamic_group.so", RTLD_LOCAL | RTLD_NOW);
+  ASSERT_NE(nullptr, lib) << dlerror();
+
+  // Allocate this thread's TLS block in each of them.
+  for (const char* member : kMembers) {
+    void* member_lib = dlopen(member, RTLD_LOCAL | RTLD_NOW | RTLD_NOLOAD);
+    ASSERT_NE(nullptr, member_lib) << member;
+    auto bump = reinterpret_cast<int (*)()>(dlsym(member_lib, "bump"));
+    ASSERT_NE(nullptr, bump) << member;
+    bump();
+    ASSERT_EQ(0, dlclose(member_lib));
+  }
+
+  struct Members {
+    size_t count;
+    std::vector<std::pair<uintptr_t, uintptr_t>> ranges;
+  };
+  auto find_members = []() {
+    Members result {};
+    dl_iterate_phdr([](dl_phdr_info* info, size_t, void* data) {
+      Members& members = *static_cast<Members*>(data);
+      std::string name = android::base::Basename(info->dlpi_name);
+      for (const char* member : kMembers) {
+        if (name != member) continue;
+        ++members.count;
+        for (ElfW(Half) i = 0; i < info->dlpi_phnum; ++i) {
+          const ElfW(Phdr)& phdr = info->dlpi_phdr[i];
+          if (phdr.p_type != PT_LOAD) continue;
+          uintptr_t start = info->dlpi_addr + phdr.p_vaddr;
+          members.ranges.emplace_back(start & ~(getpagesize() - 1), start + phdr.p_memsz);
+        }
+      }
+      return 0;
+    }, &result);
+    return result;
+  };
+
+  Members members = find_members();
+  ASSERT_EQ(std::size(kMembers), members.count);
+  ASSERT_FALSE(members.ranges.empty());
+
+  ASSERT_EQ(0, dlclose(lib));
+
+  Members after = find_members();
+  ASSERT_EQ(0U, after.count);
+
+  // mincore fails with ENOMEM for a page that isn't mapped.
+  unsigned char vec;
+  for (const auto& [start, end] : members.ranges) {
+    for (uintptr_t page = start; page < end; page += getpagesize()) {
+      errno = 0;
+      ASSERT_EQ(-1, mincore(reinterpret_cast<void*>(page), getpagesize(), &vec))
+          << std::hex << page;
+      ASSERT_EQ(ENOMEM, errno);
+    }
+  }
+#else
+  GTEST_SKIP() << "test doesn't apply to glibc";
+#endif
+}
+
 // Use dlsym to get the address of a TLS variable in static TLS and compare it
 // against the ordinary address of the variable.
 TEST(elftls_dl, dlsym_static_tls) {
@@ -0,0 +1,27 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <dlfcn.h>
+
+#include "CHECK.h"
+
+int main(void) {
+  // Each library checks that its own CFI shadow is in place in its constructor.
+  void* handle = dlopen("libcfi-test-closure.so", RTLD_NOW | RTLD_LOCAL);
+  CHECK(handle != nullptr);
+  CHECK(dlclose(handle) == 0);
+  return 0;
+}
@@ -0,0 +1,32 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// Shared by libconcurrent_constructors_slow{1,2}.so, whose constructors each wait for the other's
+// to start. They can only both see the other one when they run at the same time.
+static std::atomic<int> g_started = 0;
+
+extern "C" bool concurrent_constructors_wait_for_other() {
+  ++g_started;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (g_started < 2 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return g_started >= 2;
+}
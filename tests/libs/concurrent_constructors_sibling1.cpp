@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <dlfcn.h>
+
+// libconcurrent_constructors_root.so depends on this library and then on
+// libconcurrent_constructors_sibling2.so, so this constructor runs first. The dlopen() must run
+// the sibling's constructor before returning it.
+static int g_seen = -1;
+
+static void __attribute__((constructor)) init() {
+  void* handle = dlopen("libconcurrent_constructors_sibling2.so", RTLD_NOW);
+  if (handle == nullptr) return;
+  auto fn = reinterpret_cast<int (*)()>(dlsym(handle, "concurrent_constructors_sibling_value"));
+  if (fn != nullptr) g_seen = fn();
+}
+
+extern "C" int concurrent_constructors_sibling_value_seen() {
+  return g_seen;
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <dlfcn.h>
+#include <stdio.h>
+
+#include <thread>
+
+// Loads two libraries from two threads at once, each of whose constructors waits for the other's
+// to start, and then a library one of whose dependencies dlopen()s another. Run with a linker
+// config that enables concurrent_constructors for the default namespace.
+static bool load_slow(const char* name) {
+  void* handle = dlopen(name, RTLD_NOW);
+  if (handle == nullptr) {
+    printf("%s\n", dlerror());
+    return false;
+  }
+  auto fn = reinterpret_cast<bool (*)()>(dlsym(handle, "concurrent_constructors_overlapped"));
+  return fn != nullptr && fn();
+}
+
+int main() {
+  bool overlapped1 = false;
+  bool overlapped2 = false;
+  std::thread t1([&] { overlapped1 = load_slow("libconcurrent_constructors_slow1.so"); });
+  std::thread t2([&] { overlapped2 = load_slow("libconcurrent_constructors_slow2.so"); });
+  t1.join();
+  t2.join();
+  printf("overlapped: %s\n", (overlapped1 && overlapped2) ? "yes" : "no");
+
+  void* handle = dlopen("libconcurrent_constructors_root.so", RTLD_NOW);
+  if (handle == nullptr) {
+    printf("%s\n", dlerror());
+    return 1;
+  }
+  auto fn = reinterpret_cast<int (*)()>(dlsym(handle, "concurrent_constructors_sibling_value_seen"));
+  printf("sibling value: %d\n", fn != nullptr ? fn() : -1);
+  return 0;
+}
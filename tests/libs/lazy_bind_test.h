@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+typedef float lazy_bind_test_v4f __attribute__((vector_size(16)));
+
+extern "C" long lazy_bind_test_ints(long a, long b, long c, long d, long e, long f, long g,
+                                    long h, long i);
+extern "C" double lazy_bind_test_doubles(double a, double b, double c, double d, double e,
+                                         double f, double g, double h, double i);
+extern "C" lazy_bind_test_v4f lazy_bind_test_vectors(lazy_bind_test_v4f a, lazy_bind_test_v4f b,
+                                                     lazy_bind_test_v4f c, lazy_bind_test_v4f d,
+                                                     lazy_bind_test_v4f e, lazy_bind_test_v4f f,
+                                                     lazy_bind_test_v4f g, lazy_bind_test_v4f h);
+extern "C" double lazy_bind_test_mixed(int a, double b, long c, float d, lazy_bind_test_v4f e);
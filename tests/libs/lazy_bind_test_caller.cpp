@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include "lazy_bind_test.h"
+
+// This library is listed in LD_BIND_LAZY by dl.lazy_bind, so the first call to each function
+// goes through the lazy binding trampoline and the second one straight to the bound function.
+// Both must see the same arguments.
+
+static bool check_vector(lazy_bind_test_v4f v, float expected0) {
+  for (int i = 0; i < 4; ++i) {
+    if (v[i] != expected0 + 36 * i) return false;
+  }
+  return true;
+}
+
+extern "C" bool lazy_bind_test_run() {
+  bool ok = true;
+  for (int round = 0; round < 2; ++round) {
+    if (lazy_bind_test_ints(1, 2, 3, 4, 5, 6, 7, 8, 9) != 285) {
+      printf("ints failed in round %d\n", round);
+      ok = false;
+    }
+    if (lazy_bind_test_doubles(0.5, 1.5, 2.5, 3.5, 4.5, 5.5, 6.5, 7.5, 8.5) != 262.5) {
+      printf("doubles failed in round %d\n", round);
+      ok = false;
+    }
+    // Each argument is {n, n + 1, n + 2, n + 3}, so lane i of the result is 36 * i more than
+    // lane 0.
+    lazy_bind_test_v4f args[8];
+    for (int i = 0; i < 8; ++i) {
+      args[i] = lazy_bind_test_v4f{ 1.0f * i, i + 1.0f, i + 2.0f, i + 3.0f };
+    }
+    lazy_bind_test_v4f v = lazy_bind_test_vectors(args[0], args[1], args[2], args[3], args[4],
+                                                  args[5], args[6], args[7]);
+    if (!check_vector(v, 168)) {
+      printf("vectors failed in round %d\n", round);
+      ok = false;
+    }
+    if (lazy_bind_test_mixed(1, 2.5, 3, 4.5f, lazy_bind_test_v4f{ 1, 2, 3, 4 }) != 83) {
+      printf("mixed failed in round %d\n", round);
+      ok = false;
+    }
+  }
+  return ok;
+}
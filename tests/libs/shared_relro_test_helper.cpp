@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <string.h>
+
+// Loads libdlext_test.so and prints where it was loaded, and whether its RELRO segment is backed
+// by a shared RELRO file ("shared") or by anonymous memory ("private").
+int main() {
+  void* handle = dlopen("libdlext_test.so", RTLD_NOW);
+  if (handle == nullptr) {
+    printf("%s\n", dlerror());
+    return 1;
+  }
+  typedef int (*fn_t)();
+  fn_t get_random_number = reinterpret_cast<fn_t>(dlsym(handle, "getRandomNumber"));
+  if (get_random_number == nullptr || get_random_number() != 4) {
+    printf("getRandomNumber failed\n");
+    return 1;
+  }
+
+  Dl_info info;
+  if (dladdr(reinterpret_cast<void*>(get_random_number), &info) == 0) {
+    printf("dladdr failed\n");
+    return 1;
+  }
+
+  bool shared = false;
+  FILE* fp = fopen("/proc/self/maps", "re");
+  if (fp == nullptr) {
+    printf("couldn't open /proc/self/maps\n");
+    return 1;
+  }
+  char line[BUFSIZ];
+  while (fgets(line, sizeof(line), fp) != nullptr) {
+    if (strstr(line, "libdlext_test.so.relro") != nullptr) shared = true;
+  }
+  fclose(fp);
+
+  printf("%p %s\n", info.dli_fbase, shared ? "shared" : "private");
+  return 0;
+}
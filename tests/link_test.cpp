@@ -30,11 +30,14 @@
 
 #include <dlfcn.h>
 #include <link.h>
+#include <string.h>
 #if __has_include(<sys/auxv.h>)
 #include <sys/auxv.h>
 #endif
 
+#include <atomic>
 #include <string>
+#include <thread>
 #include <unordered_map>
 
 TEST(link, dl_iterate_phdr_early_exit) {
@@ -127,6 +130,36 @@ TEST(link, dl_iterate_phdr_counters) {
   ASSERT_LT(before_dlclose.subs, after_dlclose.subs);
 }
 
+// dl_iterate_phdr doesn't take the loader lock, so make sure that nothing it reports is released
+// under it while another thread loads and unloads a library (with TLS) as fast as it can.
+TEST(link, dl_iterate_phdr_during_dlopen_dlclose) {
+  std::atomic<bool> done = false;
+  std::thread loader([&done] {
+    while (!done) {
+      void* handle = dlopen("libtest_elftls_dynamic.so", RTLD_NOW | RTLD_LOCAL);
+      ASSERT_NE(nullptr, handle) << dlerror();
+      ASSERT_EQ(0, dlclose(handle)) << dlerror();
+    }
+  });
+
+  auto callback = [](dl_phdr_info* info, size_t, void* data) {
+    size_t& sum = *static_cast<size_t*>(data);
+    for (ElfW(Half) i = 0; i < info->dlpi_phnum; ++i) {
+      sum += info->dlpi_phdr[i].p_type;
+    }
+    if (info->dlpi_name != nullptr) sum += strlen(info->dlpi_name);
+    if (info->dlpi_tls_data != nullptr) sum += *static_cast<volatile char*>(info->dlpi_tls_data);
+    return 0;
+  };
+  size_t sum = 0;
+  for (size_t i = 0; i < 10000; ++i) {
+    EXPECT_EQ(0, dl_iterate_phdr(callback, &sum));
+  }
+
+  done = true;
+  loader.join();
+}
+
 struct ProgHdr {
   const ElfW(Phdr)* table;
   size_t size;